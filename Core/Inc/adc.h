@@ -47,6 +47,14 @@ extern uint16_t adc_raw_values[ADC_CHANNEL_COUNT];
 // Array to store calculated ADC values
 extern uint32_t adc_calculated_values[ADC_CHANNEL_COUNT];
 
+// Scaling of one channel to its calculated value (mV) and the window it should read in
+typedef struct {
+    uint32_t mult;
+    uint32_t div;
+    uint32_t min_mv;            // Below this the value is flagged LOW
+    uint32_t max_mv;            // Above this the value is flagged HIGH, 0 = no window
+} ADC_Scale;
+
 /* Structure for ADC readings */
 typedef struct {
     uint16_t inverter;
@@ -88,6 +96,8 @@ void ADC_Init(void);
 void printADCValues(char *buffer, bool raw);
 void printADCRaw(char *buffer);
 void printADCCalc(char *buffer);
+void ADC_SetScale(const ADC_Scale* scale);
+const char* ADC_LimitFlag(int channel);
 
 //void configureADCChannels(void);
 //void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc_ptr);
@@ -8,6 +8,8 @@
 #ifndef INC_COMMAND_H_
 #define INC_COMMAND_H_
 
+#define CMD_REPLY_SIZE 256      // Short replies; long ones (HELP, STATUS, dumps) use the 10000-byte buffer
+
 extern void processSerialCommand(char* command, char* data);
 extern void sendReply(const char* from, const char* message);
 extern void sendDebug(const char* from, const char* message);
@@ -0,0 +1,71 @@
+/*
+ * config.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: mavorpdx
+ */
+
+#ifndef INC_CONFIG_H_
+#define INC_CONFIG_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stm32f0xx_hal.h"
+#include "gpio.h"
+#include "utils.h"
+
+#define CONFIG_MAX_PINS         GPIO_WRITE_MAX_PINS  // Output keys in one batch
+#define CONFIG_ERROR_TEXT       96      // Room for the per-key errors in the reply
+#define CONFIG_BLOCK_TIMEOUT_MS 2000    // An open block is dropped after this long without a line
+
+/**
+ * @brief Drop anything staged and start a new batch
+ * @param block: Collect the following command lines until END (CONFIG BEGIN)
+ */
+void CONFIG_Begin(bool block);
+
+/**
+ * @brief Stage "KEY=VALUE" tokens separated by spaces or commas
+ *
+ * Keys are output pin names (1/0, ON/OFF, HIGH/LOW, TRUE/FALSE), BAUD0,
+ * BAUD1, BAUD2, BAUD3, BAUD485, SERCFG and PROFILE, case-insensitive.
+ * A bad key is recorded for the result and the rest are still staged.
+ */
+void CONFIG_AddTokens(char* text);
+
+/**
+ * @brief Stage one command line of a CONFIG BEGIN block
+ *
+ * Besides KEY=VALUE tokens this takes the single-key commands the host
+ * script sends one at a time: "SET <pin>", "CLR <pin>" and "<key> <value>".
+ * @param command: First word of the line, uppercased
+ * @param data: Rest of the line, may be NULL
+ */
+void CONFIG_AddLine(char* command, char* data);
+
+/**
+ * @brief A CONFIG BEGIN block is collecting lines
+ *
+ * A block that has been idle for CONFIG_BLOCK_TIMEOUT_MS is dropped here,
+ * so a host that never sends END cannot swallow later commands.
+ */
+bool CONFIG_BlockOpen(void);
+
+/**
+ * @brief Apply everything staged in one pass and end the batch
+ *
+ * Order: PROFILE (with its defaults), port rates, outputs in one
+ * GPIO_WritePins() batch, then SERCFG, so explicit keys override the
+ * profile and the serial mode has the last word on the transceiver pins.
+ * @param buffer: Gets "OK <keys>" or "ERROR <applied>/<keys> <key>:<reason> ..."
+ * @return HAL_OK if every key was applied
+ */
+HAL_StatusTypeDef CONFIG_Apply(char* buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_CONFIG_H_ */
@@ -38,24 +38,78 @@ typedef enum {
     GPIO_TYPE_PCA9534  // PCA9534 I2C GPIO expander
 } GPIO_PortType;
 
+typedef enum {
+    GPIO_DIR_OUTPUT,   // Driven by the tester
+    GPIO_DIR_INPUT     // Sampled by the tester
+} GPIO_Direction;
+
 typedef struct {
     GPIO_PortType type;        // Type of GPIO (MCU or PCA9534)
+    GPIO_Direction dir;        // Output or input
     GPIO_TypeDef* GPIOx;       // MCU GPIO port (GPIOA, GPIOB, etc.) - for MCU pins
     uint16_t GPIO_Pin;         // MCU GPIO pin number - for MCU pins
     uint8_t PCA9534_Pin;       // PCA9534 pin number - for PCA9534 pins
-    char name[16];             // Pin name for reference
+    char name[20];             // Pin name for reference
+    const char* description;   // Inputs only
+    int activeState;           // Inputs only - level that counts as active
 } GPIO_PinConfig;
 
-// GPIO Input Configuration
+// GPIO Input Configuration - inputs live in the same pin table as outputs
+typedef GPIO_PinConfig GPIO_InputConfig;
+
+// One entry of a multi-pin update (see GPIO_WritePins)
+typedef struct {
+    const GPIO_PinConfig* config;
+    GPIO_PinState state;
+} GPIO_PinWrite;
+
+#define GPIO_WRITE_MAX_PINS 16     // Max pin=value pairs in one GPIO_WRITE
+#define GPIO_STATE_WORDS    2      // Words in an output snapshot, one bit per pin table entry (max 64)
+#define PG_TIME_DEFAULT_MS  1000   // PG_TIME timeout when none is given
+#define PG_TIME_MAX_MS      60000  // Longest PG_TIME wait
+#define PG_TIME_SPIN_MS     200    // PG_TIME polls the input this long before handing over to the main loop
+
+// Input change event recorded from EXTI
 typedef struct {
-    GPIO_TypeDef* GPIOx;
-    uint16_t GPIO_Pin;
-    char name[20];
-    char description[50];
-    int activeState;
-} GPIO_InputConfig;
+    uint32_t timestamp_us;     // micros() when the edge was serviced
+    uint8_t pin_index;         // Index into the pin table
+    uint8_t level;             // Pin level after the edge (0/1)
+} GPIO_InputEvent;
+
+#define GPIO_EVENT_BUFFER_SIZE 64  // Ring size, one slot is kept free
+
+// Edge callback run from EXTI with the pin level and micros() at entry
+typedef void (*GPIO_EdgeHook)(uint8_t level, uint32_t now_us);
+
+// Per-input debounce state, updated from EXTI and the 1 ms SysTick sampler
+typedef struct {
+    uint32_t debounce_us;      // Window a new level must hold, 0 = off
+    uint32_t last_edge_us;     // micros() of the last raw level change
+    uint32_t glitches;         // Pulses that ended inside the window
+    uint8_t raw;               // Last raw level seen
+    uint8_t stable;            // Debounced level
+} GPIO_DebounceState;
+
+// Pending WAIT on an input's debounced state
+typedef struct {
+    const GPIO_InputConfig* config;  // NULL = free slot
+    bool active;               // Waiting for ACTIVE (true) or INACTIVE
+    uint32_t start_us;         // micros() when the wait started
+    uint32_t start_ms;         // millis() when the wait started, for the timeout
+    uint32_t timeout_ms;
+} GPIO_InputWait;
+
+#define GPIO_WAIT_MAX 4            // Concurrent WAITs
+
+// Transceiver pin writes for one serialCFG mode, see setSerialCFG()
+typedef struct {
+    const char* name;
+    uint32_t brk;              // BSRR word turning unused transceivers off, written first
+    uint32_t make;             // BSRR word turning the mode's transceivers on
+} GPIO_SerialMode;
 
 // Function declarations to add to gpio.h
+const GPIO_PinConfig* GPIO_FindByName(const char* name);
 const GPIO_InputConfig* GPIO_FindInputByName(const char* name);
 
 int GPIO_ReadInputByName(const char* name);
@@ -67,10 +121,39 @@ void GPIO_PrintDetailedInfo(char *buffer);
 
 HAL_StatusTypeDef GPIO_SetPin(const GPIO_PinConfig* config, GPIO_PinState state);
 HAL_StatusTypeDef GPIO_GetPin(const GPIO_PinConfig* config, GPIO_PinState* state);
+HAL_StatusTypeDef GPIO_WritePins(const GPIO_PinWrite* writes, int count);
+int GPIO_GetOutputStates(uint32_t* outputs, uint32_t* levels);
+HAL_StatusTypeDef GPIO_SetOutputStates(int pin_count, const uint32_t* outputs, const uint32_t* levels);
+HAL_StatusTypeDef GPIO_StartResponse(const GPIO_PinConfig* out, GPIO_PinState level,
+                                     const GPIO_InputConfig* in, bool active, uint32_t timeout_us);
+void GPIO_ProcessResponse(void);
 HAL_StatusTypeDef GPIO_SetOutputByName(const char* name, GPIO_PinState state);
 HAL_StatusTypeDef GPIO_ToggleByName(const char* name);
 void GPIO_PrintStates(char *buffer);
+
+HAL_StatusTypeDef GPIO_ArmInputEvent(const char* name);
+HAL_StatusTypeDef GPIO_DisarmInputEvent(const char* name);
+HAL_StatusTypeDef GPIO_SetEdgeHook(const GPIO_InputConfig* config, GPIO_EdgeHook hook);
+void GPIO_SetEventPush(bool enable);
+bool GPIO_GetEventPush(void);
+void GPIO_PrintEvents(char *buffer);
+void GPIO_ProcessEvents(void);
+HAL_StatusTypeDef GPIO_SetDebounce(const char* name, uint32_t debounce_us);
+HAL_StatusTypeDef GPIO_GetDebounce(const char* name, uint32_t* debounce_us);
+HAL_StatusTypeDef GPIO_GetLastEdge(const GPIO_InputConfig* config, uint8_t* level, uint32_t* when_us);
+HAL_StatusTypeDef GPIO_StartWait(const char* name, bool active, uint32_t timeout_ms);
+void GPIO_ProcessWaits(void);
+void GPIO_PrintGlitches(char *buffer);
+void GPIO_ClearGlitches(void);
+void GPIO_InputTick(void);
+void EXTI0_1_IRQHandler(void);
+void EXTI2_3_IRQHandler(void);
+void EXTI4_15_IRQHandler(void);
 void setSerialCFG(void);
+uint8_t GPIO_SerialModeCount(void);
+HAL_StatusTypeDef GPIO_SetPCADirection(const char* name, bool input);
+void GPIO_PrintPCAStatus(char *buffer);
+void GPIO_PrintSerialCFG(char *buffer);
 void GPIO_Init(void);
 void MX_GPIO_Init(void);
 void updateLEDStatus(void);
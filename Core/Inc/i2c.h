@@ -20,10 +20,122 @@ extern I2C_HandleTypeDef hi2c2;
 
 void I2C_Init(void);
 
-// Define register addresses
-#define I2C_REG_0       0x00
-#define I2C_REG_1       0x01
-#define I2C_NUM_REGS    2
+// I2C2 master transaction queue (PCA9534)
+#define I2C_MASTER_QUEUE_SIZE   8       // Transactions waiting or in flight
+#define I2C_MASTER_MAX_DATA     4       // Data bytes per transaction
+#define I2C_MASTER_TIMEOUT_MS   10      // Default per-transaction timeout
+#define I2C_MASTER_DEFAULT_KHZ  100
+
+typedef void (*I2C_MasterCallback)(HAL_StatusTypeDef status, void* context);
+
+typedef struct {
+    uint16_t dev_address;               // 7-bit address shifted left by 1
+    uint8_t reg;                        // Register to write, or to read from
+    bool read;                          // true = register read, false = register write
+    uint8_t length;                     // Data bytes, 1..I2C_MASTER_MAX_DATA
+    uint8_t data[I2C_MASTER_MAX_DATA];  // Write data, or read result
+    uint8_t* rx;                        // Read result is copied here on success, may be NULL
+    uint32_t timeout_ms;                // 0 = I2C_MASTER_TIMEOUT_MS
+    I2C_MasterCallback callback;        // Runs in interrupt context, may be NULL
+    void* context;                      // Passed to callback
+} I2C_MasterXfer;
+
+HAL_StatusTypeDef I2C_MasterSubmit(const I2C_MasterXfer* xfer);
+
+/**
+ * @brief Blocking register write/read through the queue
+ * @return HAL_OK, HAL_ERROR (NACK/bus error, or called from interrupt context),
+ *         HAL_TIMEOUT, or HAL_BUSY if the queue is full
+ */
+HAL_StatusTypeDef I2C_MasterWriteReg(uint16_t dev_address, uint8_t reg, const uint8_t* data, uint8_t length);
+HAL_StatusTypeDef I2C_MasterReadReg(uint16_t dev_address, uint8_t reg, uint8_t* data, uint8_t length);
+
+void I2C_MasterTick(void);
+HAL_StatusTypeDef I2C_MasterSetSpeed(uint32_t khz);
+uint32_t I2C_MasterGetSpeed(void);
+
+// Bus fault recovery (I2C2 pins clocked by hand, see I2C_MasterTick)
+#define I2C2_BUS_PORT           GPIOB
+#define I2C2_SCL_PIN            GPIO_PIN_10
+#define I2C2_SDA_PIN            GPIO_PIN_11
+#define I2C_RECOVER_PULSES      9       // SCL pulses to free a slave holding SDA
+#define I2C_RECOVER_HALF_US     5       // SCL half period during recovery (100 kHz)
+
+// Per-bus error counters
+typedef enum {
+    I2C_BUS_SLAVE = 0,                  // I2C1, tester as slave
+    I2C_BUS_MASTER,                     // I2C2, PCA9534
+    I2C_BUS_COUNT
+} I2C_Bus;
+
+typedef struct {
+    uint32_t nack;                      // Address or data not acknowledged
+    uint32_t arbitration;               // Arbitration lost
+    uint32_t bus_error;                 // Misplaced START/STOP
+    uint32_t overrun;                   // Slave overrun/underrun
+    uint32_t timeout;                   // Master transactions that timed out
+    uint32_t recoveries;                // Bus recoveries / peripheral re-inits
+} I2C_BusStats;
+
+extern volatile I2C_BusStats i2c_stats[I2C_BUS_COUNT];
+
+void I2C_Process(void);
+void I2C_PrintStats(char *buffer);
+void I2C_ClearStats(void);
+void I2C1_IRQHandler(void);
+void I2C2_IRQHandler(void);
+
+// Slave register file, read and written with an auto-incrementing pointer
+#define I2C_REG_FILE_MAX    256     // Largest map per address
+#define I2C_REG_FILE_SIZE   256     // Size at power-up
+#define I2C_SLAVE_MEM_SIZE  1536    // Backing array, shared by both devices and EEPROM mode
+#define I2C_OA2_ADDR_MIN    0x08    // OA2 ranges stay clear of the reserved 0x00-0x07 and 0x78-0x7F
+#define I2C_OA2_ADDR_MAX    0x77
+
+// Emulated devices, one per own address
+typedef enum {
+    I2C_SLAVE_DEV_OA1 = 0,      // I2C_SLAVE_ADDR
+    I2C_SLAVE_DEV_OA2,          // I2C_SLAVE_ADDR2, optionally an address range
+    I2C_SLAVE_DEV_COUNT
+} I2C_SlaveDev;
+
+// EEPROM emulation (24Cxx), see I2C_SetEepromMode
+#define I2C_EEPROM_PAGE_MAX         64
+#define I2C_EEPROM_DEFAULT_WRITE_MS 5       // Typical 24Cxx tWR
+#define I2C_EEPROM_MAX_WRITE_MS     1000
+
+typedef struct {
+    uint16_t size;              // Array size in bytes, all banks of an OA2 range together
+    uint8_t addr_bytes;         // Word address length: 1 (24C01/02) or 2 (24C32 style)
+    uint8_t page;               // Page write size, a power of two
+    uint16_t write_ms;          // Address NACKed this long after a write, 0 = never
+} I2C_EepromConfig;
+
+// Slave transaction recorded from the I2C1 interrupt
+typedef struct {
+    uint32_t timestamp_us;      // micros() at the address match
+    uint16_t bytes;             // Data bytes moved, not counting the pointer byte
+    uint16_t reg;               // Register pointer (EEPROM word address) at the first data byte
+    uint8_t address;            // 7-bit address the master used
+    uint8_t read;               // 1 = master read, 0 = master write
+    uint8_t error;              // HAL_I2C_ERROR_* bits, 0 = completed normally
+    uint8_t nacked;             // 1 = a written byte was NACKed by injection, bytes counts those before it
+    uint16_t stretch_us;        // SCL held low after the address match by injection, 0 = none
+} I2C_SlaveLogEntry;
+
+#define I2C_SLAVE_LOG_SIZE  32      // Ring size, one slot is kept free
+
+// Fault injection on the I2C1 slave, see I2C_SetSlaveInject
+#define I2C_INJECT_MAX_STRETCH_US   65535   // Fits the log entry
+#define I2C_INJECT_SPIN_US          50      // Up to this the stretch busy-waits in the I2C1 interrupt
+#define I2C_INJECT_NACK_OFF         0xFFFF
+
+typedef struct {
+    uint32_t stretch_us;        // SCL held low after the address match, 0 = off
+    bool stretch_read;          // Stretch before the data of master reads
+    bool stretch_write;         // Stretch before the pointer of master writes
+    uint16_t nack_byte;         // Written byte to NACK, 0 = first after the address, or I2C_INJECT_NACK_OFF
+} I2C_SlaveInject;
 
 /**
  * @brief Initialize I2C slave mode with register access
@@ -39,26 +151,157 @@ HAL_StatusTypeDef I2C_SlaveInit(uint8_t address);
  */
 HAL_StatusTypeDef I2C_SetSlaveAddress(uint8_t address);
 
+/**
+ * @brief Get the I2C slave address
+ * @return 7-bit address (OA1)
+ */
+uint8_t I2C_GetSlaveAddress(void);
+
+/**
+ * @brief Set or turn off the second own address (OA2)
+ * @param address: 7-bit address, 0 to turn OA2 off
+ * @param mask_bits: Low address bits to ignore (0-7); the OA2 device is split
+ *        into one equal bank per address in the range
+ * @return HAL_OK, or HAL_ERROR if the range leaves I2C_OA2_ADDR_MIN-I2C_OA2_ADDR_MAX
+ *         or the OA2 map does not split or fit
+ */
+HAL_StatusTypeDef I2C_SetSecondAddress(uint8_t address, uint8_t mask_bits);
+
+/**
+ * @brief Get the second own address
+ * @param mask_bits: Set to the low address bits ignored, may be NULL
+ * @return 7-bit address (first of the range), 0 if OA2 is off
+ */
+uint8_t I2C_GetSecondAddress(uint8_t* mask_bits);
+
 /**
  * @brief Set a register value
- * @param reg_addr: Register address (0 or 1)
+ * @param dev: Device (OA1 or OA2)
+ * @param reg_addr: Register address, below the current map size
  * @param value: Value to set
  * @return HAL_StatusTypeDef
  */
-HAL_StatusTypeDef I2C_SetRegisterValue(uint8_t reg_addr, uint8_t value);
+HAL_StatusTypeDef I2C_SetRegisterValue(I2C_SlaveDev dev, uint16_t reg_addr, uint8_t value);
 
 /**
  * @brief Get a register value
- * @param reg_addr: Register address (0 or 1)
+ * @param dev: Device (OA1 or OA2)
+ * @param reg_addr: Register address, below the current map size
  * @param value: Pointer to store the value
  * @return HAL_StatusTypeDef
  */
-HAL_StatusTypeDef I2C_GetRegisterValue(uint8_t reg_addr, uint8_t* value);
+HAL_StatusTypeDef I2C_GetRegisterValue(I2C_SlaveDev dev, uint16_t reg_addr, uint8_t* value);
 
 /**
  * @brief Print the current status of I2C slave registers
  */
 void I2C_PrintSlaveStatus(void);
 
+/**
+ * @brief Change the size of a device's register map (leaves EEPROM mode)
+ * @param dev: Device (OA1 or OA2)
+ * @param size: Up to I2C_REG_FILE_MAX bytes per bank; addresses wrap at the bank size
+ * @return HAL_OK, or HAL_ERROR on a bad size
+ */
+HAL_StatusTypeDef I2C_SetRegisterFileSize(I2C_SlaveDev dev, uint16_t size);
+
+/**
+ * @brief Current size of a device's register map or EEPROM array
+ */
+uint16_t I2C_GetRegisterFileSize(I2C_SlaveDev dev);
+
+/**
+ * @brief Copy bytes into a device's register map
+ * @param dev: Device (OA1 or OA2)
+ * @param start: First register
+ * @param data: Values to store
+ * @param length: Number of bytes, must fit below the map size
+ * @return HAL_OK, or HAL_ERROR if the range is outside the map
+ */
+HAL_StatusTypeDef I2C_LoadRegisters(I2C_SlaveDev dev, uint16_t start, const uint8_t* data, uint16_t length);
+
+/**
+ * @brief Print part of a device's register map as a hex string
+ * @param dev: Device (OA1 or OA2)
+ * @param buffer: Output buffer, 2 * length + 1 bytes
+ * @param start: First register
+ * @param length: Number of bytes, must fit below the map size
+ * @return HAL_OK, or HAL_ERROR if the range is outside the map
+ */
+HAL_StatusTypeDef I2C_DumpRegisters(I2C_SlaveDev dev, char* buffer, uint16_t start, uint16_t length);
+
+/**
+ * @brief Make a device behave like a 24Cxx EEPROM over its memory
+ * @param dev: Device (OA1 or OA2)
+ * @param config: Geometry and write cycle, NULL to go back to 256-byte register maps
+ * @return HAL_OK, or HAL_ERROR on a bad geometry
+ */
+HAL_StatusTypeDef I2C_SetEepromMode(I2C_SlaveDev dev, const I2C_EepromConfig* config);
+
+/**
+ * @brief Print a device's EEPROM mode settings and write count
+ */
+void I2C_PrintEepromStatus(I2C_SlaveDev dev, char* buffer);
+
+/**
+ * @brief End EEPROM write cycles, called every 1 ms from SysTick
+ */
+void I2C_SlaveTick(void);
+
+/**
+ * @brief Drain the slave transaction log into buffer, one line per transaction
+ * @param buffer: Output buffer
+ */
+void I2C_PrintSlaveLog(char* buffer);
+
+/**
+ * @brief Discard logged slave transactions
+ */
+void I2C_ClearSlaveLog(void);
+
+/**
+ * @brief Set clock-stretch and NACK injection on the I2C1 slave
+ *
+ * The stretch is timed from the address interrupt, so SCL is low for
+ * stretch_us plus the interrupt entry latency (a few us). Each logged
+ * transaction records the stretch actually applied.
+ * @param inject: Settings, NULL to turn injection off
+ * @return HAL_OK, or HAL_ERROR on a stretch that is too long or has no direction
+ */
+HAL_StatusTypeDef I2C_SetSlaveInject(const I2C_SlaveInject* inject);
+
+/**
+ * @brief Print the injection settings
+ */
+void I2C_PrintSlaveInject(char* buffer);
+
+/**
+ * @brief End an injected stretch, called from the TIM2 CC3 interrupt
+ */
+void I2C_SlaveStretchEnd(void);
+
+// Slave bus speed and throughput benchmark
+#define I2C_SLAVE_DEFAULT_KHZ   100     // I2C1 on HSI with the generated timing
+#define I2C_BENCH_MAX_S         60
+
+/**
+ * @brief Set the bus speed the I2C1 slave is timed for (re-initialises it)
+ * @param khz: 100, 400 or 1000; 1000 enables the Fast-mode Plus pad drivers
+ * @return HAL_OK, or HAL_ERROR for an unsupported speed
+ */
+HAL_StatusTypeDef I2C_SlaveSetSpeed(uint32_t khz);
+uint32_t I2C_SlaveGetSpeed(void);
+
+/**
+ * @brief Start counting slave traffic for a number of seconds
+ *
+ * Returns at once. I2C_Process() replies {"I2C_BENCH" : "<s>s ..."} each
+ * second and "DONE speed=<n> kHz avg ..." at the end, so the command port
+ * and the DUT bridges keep running.
+ * @param seconds: 1 to I2C_BENCH_MAX_S
+ * @return HAL_OK, HAL_BUSY if a benchmark is running, or HAL_ERROR on a bad duration
+ */
+HAL_StatusTypeDef I2C_SlaveBenchStart(uint32_t seconds);
+
 
 #endif /* INC_I2C_H_ */
@@ -0,0 +1,72 @@
+/*
+ * measure.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: mavorpdx
+ */
+
+#ifndef INC_MEASURE_H_
+#define INC_MEASURE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stm32f0xx_hal.h"
+#include "gpio.h"
+#include "utils.h"
+
+#define MEASURE_PIN_NAME            "P104"
+#define MEASURE_DEFAULT_WINDOW_MS   1000
+#define MEASURE_MAX_WINDOW_MS       10000
+#define MEASURE_PROBE_MS            10      // Count-only pass that picks the method
+#define MEASURE_EDGE_MAX_HZ         20000   // Above this only the frequency is measured
+
+// Min/mean/max of one pulse width
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t sum_us;
+} MEASURE_Width;
+
+typedef struct {
+    uint32_t window_us;         // Actual gate time
+    uint32_t edges;             // Rising edges counted by TIM3 in the gate
+    uint32_t freq_hz;           // Frequency, whole Hz
+    uint16_t freq_milli;        // Frequency, thousandths of a Hz
+    uint8_t level;              // Pin level at the end (for a static signal)
+    bool timed;                 // Edges were timestamped, widths and duty are valid
+    uint16_t duty_permille;     // High time / period, 0.1 %
+    uint32_t missed;            // Edges lost to interrupt latency (timed only)
+    MEASURE_Width high;
+    MEASURE_Width low;
+} MEASURE_Result;
+
+/**
+ * @brief Start measuring frequency, duty cycle and pulse widths on P104
+ *
+ * Returns at once; MEASURE_Process() replies {"MEASURE" : "..."} when the
+ * gate closes, or "BUSY" if the pin's EXTI line turns out to be in use.
+ * @param window_ms: Gate time, 0 for the default
+ * @return HAL_OK, HAL_BUSY if a measurement is running, HAL_ERROR otherwise
+ */
+HAL_StatusTypeDef MEASURE_Start(uint32_t window_ms);
+
+/**
+ * @brief Advance a running measurement and reply when it is done, called from the main loop
+ */
+void MEASURE_Process(void);
+
+/**
+ * @brief Print a measurement as one reply line
+ */
+void MEASURE_Format(char* buffer, const MEASURE_Result* result);
+
+void TIM3_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_MEASURE_H_ */
@@ -17,8 +17,22 @@ typedef enum {
 
 /* Device context structure */
 typedef struct {
-    I2C_HandleTypeDef *hi2c;  // Pointer to the HAL I2C handle
+    I2C_HandleTypeDef *hi2c;  // Pointer to the HAL I2C handle (must be hi2c2, see i2c.h master queue)
     uint16_t DevAddress;      // I2C address of the PCA9534 (7-bit address shifted left by 1)
+    uint8_t OutputShadow;     // Last value the device acknowledged in the output register
+    uint8_t OutputRequest;    // Newest value asked for, ahead of OutputShadow while a write is in flight
+    uint8_t ConfigShadow;     // Last value written to the configuration register
+    uint8_t InputCache;       // Last value read from the input register
+    volatile bool InputValid; // InputCache is current (see IntTracking)
+    bool IntTracking;         // INTn is wired up: only an INTn edge or a config write stales the cache
+    volatile uint32_t IntCount;   // INTn assertions seen (PCA9534_NotifyInt)
+    uint32_t InputReads;      // Input register reads actually sent on the bus
+    volatile bool TxBusy;     // Interrupt-driven write in flight
+    volatile bool TxPending;  // OutputRequest changed while TxBusy, resend on completion
+    uint8_t TxValue;          // Output value of the write in flight
+    volatile uint8_t TxRequests;  // Serial of the newest PCA9534_WriteOutput_IT() request
+    uint8_t TxSerial;         // Newest request serial carried by the write in flight
+    volatile uint32_t TxErrors; // Interrupt-driven writes that failed
 } PCA9534_HandleTypeDef;
 
 /* PCA9534 register addresses */
@@ -38,17 +52,35 @@ typedef struct {
 #define V5_VMain_EN		(1U << 7)
 
 
+/**
+ * @brief  Toggle an individual pin of the output port.
+ * @param  hpca9534: Pointer to PCA9534 handle.
+ * @param  pin: Pin mask to toggle.
+ * @retval PCA9534_OK on success, PCA9534_ERROR on failure.
+ *
+ * @note Uses the output shadow register, so only one I2C write is issued.
+ */
 PCA9534_StatusTypeDef PCA9534_TogglePin(PCA9534_HandleTypeDef *hpca9534, uint8_t pin);
 
 /**
  * @brief  Initializes the PCA9534 device context.
  * @param  hpca9534: Pointer to PCA9534 handle.
- * @param  hi2c: Pointer to the I2C handle.
+ * @param  hi2c: Pointer to the I2C handle (hi2c2, the I2C master queue bus).
  * @param  DevAddress: 7-bit I2C address of the PCA9534 shifted left by 1.
  * @retval PCA9534_OK on success, PCA9534_ERROR on failure.
+ *
+ * @note The expander keeps its state across an MCU reset, so the output and
+ *       configuration shadows are loaded from the device here.
  */
 PCA9534_StatusTypeDef PCA9534_Init(PCA9534_HandleTypeDef *hpca9534, I2C_HandleTypeDef *hi2c, uint16_t DevAddress);
 
+/**
+ * @brief  Reload the output and configuration shadows from the device.
+ * @param  hpca9534: Pointer to PCA9534 handle.
+ * @retval PCA9534_OK on success, PCA9534_ERROR on failure.
+ */
+PCA9534_StatusTypeDef PCA9534_SyncShadow(PCA9534_HandleTypeDef *hpca9534);
+
 /**
  * @brief  Write to the configuration register.
  * @param  hpca9534: Pointer to PCA9534 handle.
@@ -58,7 +90,7 @@ PCA9534_StatusTypeDef PCA9534_Init(PCA9534_HandleTypeDef *hpca9534, I2C_HandleTy
 PCA9534_StatusTypeDef PCA9534_SetConfig(PCA9534_HandleTypeDef *hpca9534, uint8_t config);
 
 /**
- * @brief  Read the configuration register.
+ * @brief  Read the configuration register (from the shadow, no I2C traffic).
  * @param  hpca9534: Pointer to PCA9534 handle.
  * @param  config: Pointer to store the configuration value.
  * @retval PCA9534_OK on success, PCA9534_ERROR on failure.
@@ -74,13 +106,78 @@ PCA9534_StatusTypeDef PCA9534_GetConfig(PCA9534_HandleTypeDef *hpca9534, uint8_t
 PCA9534_StatusTypeDef PCA9534_WriteOutput(PCA9534_HandleTypeDef *hpca9534, uint8_t value);
 
 /**
- * @brief  Read the input port register.
+ * @brief  Write to the output port register without blocking.
+ * @param  hpca9534: Pointer to PCA9534 handle.
+ * @param  value: Value to write to the output port.
+ * @retval PCA9534_OK if the write was started or queued, PCA9534_ERROR on failure.
+ *
+ * @note Safe to call from interrupt context. OutputRequest is updated immediately,
+ *       OutputShadow only once the device acknowledges the write. If a write is
+ *       already in flight the new value is sent when it completes, so back-to-back
+ *       calls coalesce into at most one extra transaction. TxRequests afterwards
+ *       holds the serial PCA9534_OutputDoneCallback() reports for this request.
+ */
+PCA9534_StatusTypeDef PCA9534_WriteOutput_IT(PCA9534_HandleTypeDef *hpca9534, uint8_t value);
+
+/**
+ * @brief  Interrupt-driven output write finished.
+ * @param  hpca9534: Pointer to PCA9534 handle.
+ * @param  serial: Newest TxRequests serial carried by the write; every request up to it is settled.
+ * @param  ok: The device acknowledged the write.
+ *
+ * @note Called from the I2C2 interrupt. The default does nothing.
+ */
+void PCA9534_OutputDoneCallback(PCA9534_HandleTypeDef *hpca9534, uint8_t serial, bool ok);
+
+/**
+ * @brief  Set one or more pins to input or output.
+ * @param  hpca9534: Pointer to PCA9534 handle.
+ * @param  pin: Pin mask to change.
+ * @param  input: true for input, false for output.
+ * @retval PCA9534_OK on success, PCA9534_ERROR on failure.
+ *
+ * @note The output register keeps its value, so a pin switched back to output
+ *       drives the level last written for it.
+ */
+PCA9534_StatusTypeDef PCA9534_SetPinDirection(PCA9534_HandleTypeDef *hpca9534, uint8_t pin, bool input);
+
+/**
+ * @brief  Record an INTn assertion (an input pin changed since the last read).
+ * @param  hpca9534: Pointer to PCA9534 handle.
+ *
+ * @note Call from the INTn falling-edge interrupt. Setting IntTracking after
+ *       wiring this up lets output writes keep the input cache.
+ */
+void PCA9534_NotifyInt(PCA9534_HandleTypeDef *hpca9534);
+
+/**
+ * @brief  Read the output port register (from the shadow, no I2C traffic).
+ * @param  hpca9534: Pointer to PCA9534 handle.
+ * @param  value: Pointer to store the output port value.
+ * @retval PCA9534_OK on success, PCA9534_ERROR on failure.
+ */
+PCA9534_StatusTypeDef PCA9534_GetOutput(PCA9534_HandleTypeDef *hpca9534, uint8_t *value);
+
+/**
+ * @brief  Read the input port register from the device and update the cache.
  * @param  hpca9534: Pointer to PCA9534 handle.
  * @param  value: Pointer to store the input port value.
  * @retval PCA9534_OK on success, PCA9534_ERROR on failure.
  */
 PCA9534_StatusTypeDef PCA9534_ReadInput(PCA9534_HandleTypeDef *hpca9534, uint8_t *value);
 
+/**
+ * @brief  Get the input port value, from the cache when it is still current.
+ *
+ * @note With IntTracking the cache stays current until INTn asserts or the
+ *       configuration changes, so repeated reads cost no I2C traffic.
+ * @param  hpca9534: Pointer to PCA9534 handle.
+ * @param  value: Pointer to store the input port value.
+ * @param  refresh: true to force a read from the device.
+ * @retval PCA9534_OK on success, PCA9534_ERROR on failure.
+ */
+PCA9534_StatusTypeDef PCA9534_GetInput(PCA9534_HandleTypeDef *hpca9534, uint8_t *value, bool refresh);
+
 /**
  * @brief  Write to the polarity inversion register.
  * @param  hpca9534: Pointer to PCA9534 handle.
@@ -106,6 +203,7 @@ PCA9534_StatusTypeDef PCA9534_GetPolarity(PCA9534_HandleTypeDef *hpca9534, uint8
  *
  * @note Before using this function, ensure the desired pin(s) are configured as outputs
  *       (i.e., corresponding bit(s) in the configuration register should be 0).
+ *       The new value is built from the output shadow, so only one I2C write is issued.
  */
 PCA9534_StatusTypeDef PCA9534_WritePin(PCA9534_HandleTypeDef *hpca9534, uint8_t pin, uint8_t value);
 
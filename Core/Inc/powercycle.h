@@ -0,0 +1,73 @@
+/*
+ * powercycle.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: mavorpdx
+ */
+
+#ifndef INC_POWERCYCLE_H_
+#define INC_POWERCYCLE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stm32f0xx_hal.h"
+#include "gpio.h"
+#include "uart.h"
+#include "utils.h"
+
+#define CYCLE_MAX_ENABLES        GPIO_WRITE_MAX_PINS
+#define CYCLE_DEFAULT_OFF_MS     1000    // Power-off time per cycle
+#define CYCLE_DEFAULT_TIMEOUT_MS 10000   // Power-good plus banner limit per cycle
+
+typedef struct {
+    uint32_t cycles;                                // Cycles to run
+    const GPIO_PinConfig* enables[CYCLE_MAX_ENABLES];
+    int enable_count;
+    const GPIO_InputConfig* power_good;             // NULL = don't wait for power-good
+    UART_HandleTypeDef* port;                       // NULL = don't wait for a banner
+    char pattern[UART_WATCH_MAX_PATTERN + 1];       // "" = first byte on port
+    uint32_t off_ms;
+    uint32_t timeout_ms;
+} CYCLE_Config;
+
+// Running min/mean/max of one timing
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+} CYCLE_Stat;
+
+/**
+ * @brief Start a power-cycle screen, run from CYCLE_Process()
+ * @return HAL_OK, HAL_BUSY if one is running or the UART watch is in use, HAL_ERROR on a bad config
+ */
+HAL_StatusTypeDef CYCLE_Start(const CYCLE_Config* config);
+
+/**
+ * @brief A screen is running (it owns the UART watch and the enables)
+ */
+bool CYCLE_Running(void);
+
+/**
+ * @brief Stop the screen after the current step and report the results so far
+ */
+void CYCLE_Stop(void);
+
+/**
+ * @brief Print progress and statistics
+ */
+void CYCLE_PrintStatus(char* buffer);
+
+/**
+ * @brief Advance the screen, called from the main loop
+ */
+void CYCLE_Process(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_POWERCYCLE_H_ */
@@ -0,0 +1,104 @@
+/*
+ * profile.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: mavorpdx
+ */
+
+#ifndef INC_PROFILE_H_
+#define INC_PROFILE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stm32f0xx_hal.h"
+#include "adc.h"
+#include "gpio.h"
+#include "utils.h"
+
+#define PROFILE_COUNT           3       // SLCD5_TYPE, SLCD43_TYPE, SCLD6_TYPE
+#define PROFILE_MAX_OUTPUTS     16      // Default output entries per profile
+
+// Tester serial ports, in PROFILE_Config.ports[] order
+typedef enum {
+    PROFILE_PORT_COM0,      // USART1
+    PROFILE_PORT_COM1,      // USART3
+    PROFILE_PORT_COM2,      // USART5
+    PROFILE_PORT_COM3,      // USB bridge, rate is only recorded
+    PROFILE_PORT_COM485,    // USART4
+    PROFILE_PORT_COUNT
+} PROFILE_Port;
+
+// Where a tester port lands on the DUT
+typedef struct {
+    const char* connector;  // DUT connector, NULL if the model does not use the port
+    uint32_t baud_max;      // BAUDx requests above this are clamped
+    uint32_t baud;          // Rate set when the profile is selected
+    bool ttl_only;          // No RS-232/RS-485 transceiver on the DUT side
+} PROFILE_PortMap;
+
+// Output level set when the profile is selected
+typedef struct {
+    const char* name;       // Output pin table name
+    GPIO_PinState state;
+} PROFILE_Output;
+
+// Everything that changes between DUT models
+typedef struct {
+    const char* name;
+    PROFILE_PortMap ports[PROFILE_PORT_COUNT];
+    PROFILE_Output outputs[PROFILE_MAX_OUTPUTS];    // Ends at the first NULL name
+    const ADC_Scale* adc;                           // ADC_CHANNEL_COUNT entries, adc_channels[] order
+    uint8_t serial_cfg;                             // SERCFG mode for COM1
+} PROFILE_Config;
+
+/**
+ * @brief Make a profile current
+ *
+ * The ADC scale and the baud limits always follow the profile. With
+ * apply_defaults the port rates, the default outputs and the serial mode
+ * are set too; SETTINGS_Load skips them because the saved values follow.
+ * @param type: SLCD5_TYPE, SLCD43_TYPE or SCLD6_TYPE
+ * @param apply_defaults: Also set rates, outputs and SERCFG
+ * @return HAL_OK, HAL_ERROR for an unknown type or a failed output write
+ */
+HAL_StatusTypeDef PROFILE_Select(uint8_t type, bool apply_defaults);
+
+/**
+ * @brief Profile type by name (case-insensitive)
+ * @return The type, or -1 if there is no such profile
+ */
+int PROFILE_Find(const char* name);
+
+/**
+ * @brief The current profile (controllerType)
+ */
+const PROFILE_Config* PROFILE_Current(void);
+
+/**
+ * @brief Clamp a requested rate to the current profile's limit for a port
+ */
+uint32_t PROFILE_ClampBaud(PROFILE_Port port, uint32_t baud);
+
+/**
+ * @brief Clamp, store and apply a port rate; the UART is only re-initialised if the rate changes
+ * @return HAL_OK, or HAL_ERROR for a zero rate
+ */
+HAL_StatusTypeDef PROFILE_SetBaud(PROFILE_Port port, uint32_t baud);
+
+/**
+ * @brief Print the current profile's name, port map and serial mode
+ */
+void PROFILE_Print(char* buffer);
+
+/**
+ * @brief Print the names of all profiles
+ */
+void PROFILE_PrintList(char* buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_PROFILE_H_ */
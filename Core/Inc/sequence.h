@@ -0,0 +1,68 @@
+/*
+ * sequence.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: mavorpdx
+ */
+
+#ifndef INC_SEQUENCE_H_
+#define INC_SEQUENCE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stm32f0xx_hal.h"
+#include "gpio.h"
+#include "utils.h"
+
+#define SEQ_MAX_STEPS       32
+#define SEQ_RUN_MARGIN_MS   1000    // Extra time allowed past the last step
+#define SEQ_MAX_TOTAL_US    10000000 // Whole sequence, so SEQ_Run blocks ~11 s at most
+
+typedef struct {
+    uint32_t delay_us;              // Gap after the previous step (or after start)
+    const GPIO_PinConfig* pin;      // Output to drive
+    uint32_t actual_us;             // Execution time relative to start, filled by SEQ_Run
+    uint8_t level;                  // GPIO_PinState to drive it to
+    bool done;                      // Step was executed (PCA9534: the write was acknowledged)
+    uint8_t pca_write;              // PCA9534 request serial carrying the step
+    bool failed;                    // PCA9534 write carrying the step was not acknowledged
+} SEQ_Step;
+
+/**
+ * @brief Remove all steps
+ */
+void SEQ_Clear(void);
+
+/**
+ * @brief Append steps from a list of <delay_us>:<pin>=<0|1> tokens
+ *
+ * All or nothing: on error the step list is left as it was.
+ * @param list: Space or comma separated step list (modified in place)
+ * @param bad_token: Set to the offending token on error, may be NULL
+ * @return HAL_OK, or HAL_ERROR on a bad token, a full sequence or more than SEQ_MAX_TOTAL_US in all
+ */
+HAL_StatusTypeDef SEQ_AddSteps(char* list, char** bad_token);
+
+/**
+ * @brief Play the loaded steps on TIM2 and wait until they have run
+ *
+ * Also waits for the last PCA9534 write, so every PCA step has its
+ * acknowledge time or is marked failed when this returns.
+ * @return HAL_OK, or HAL_ERROR if empty, busy, or timed out
+ */
+HAL_StatusTypeDef SEQ_Run(void);
+
+/**
+ * @brief Print the steps, with actual timestamps once run and FAIL for a PCA9534 step whose write failed
+ */
+void SEQ_Print(char* buffer);
+
+void TIM2_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_SEQUENCE_H_ */
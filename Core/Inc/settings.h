@@ -0,0 +1,75 @@
+/*
+ * settings.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: mavorpdx
+ */
+
+#ifndef INC_SETTINGS_H_
+#define INC_SETTINGS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stm32f0xx_hal.h"
+#include "gpio.h"
+#include "utils.h"
+
+// Record store in the last two flash pages, kept out of FLASH by the linker script
+#define SETTINGS_FLASH_ADDR     0x0803F000U
+#define SETTINGS_PAGE_SIZE      FLASH_PAGE_SIZE     // 2 KB on the F091
+#define SETTINGS_PAGES          2
+#define SETTINGS_MAGIC          0x52544346U         // Marks a written record
+#define SETTINGS_VERSION        1                   // Bump when SETTINGS_Data changes
+
+// What SAVE keeps
+typedef struct {
+    uint32_t baud0;
+    uint32_t baud1;
+    uint32_t baud2;
+    uint32_t baud3;
+    uint32_t baud485;
+    uint32_t outputs[GPIO_STATE_WORDS];     // Pins whose level is saved, bit per pin table entry
+    uint32_t levels[GPIO_STATE_WORDS];      // Saved levels, 1 = high
+    uint8_t pin_count;                      // Pin table size the masks were taken with
+    uint8_t serial_cfg;
+    uint8_t i2c_address;                    // 7-bit I2C1 slave address (OA1)
+    uint8_t profile;                        // controllerType, 0 (SLCD5) in records from before PROFILE
+} SETTINGS_Data;
+
+// Outcome of SETTINGS_Load
+typedef enum {
+    SETTINGS_LOAD_NONE,         // No valid record saved
+    SETTINGS_LOAD_OK,           // Everything applied
+    SETTINGS_LOAD_PARTIAL       // Applied, but some settings were rejected or failed
+} SETTINGS_LoadResult;
+
+/**
+ * @brief Save the current configuration as a new record
+ *
+ * The CPU stalls while flash is written, up to ~40 ms when a page is erased.
+ * @param sequence: Set to the record's sequence number, may be NULL
+ * @return HAL_OK, or HAL_ERROR if the write did not verify
+ */
+HAL_StatusTypeDef SETTINGS_Save(uint32_t* sequence);
+
+/**
+ * @brief Apply the newest valid saved record
+ * @param sequence: Set to the record's sequence number, may be NULL
+ * @return SETTINGS_LOAD_OK, SETTINGS_LOAD_NONE if nothing is saved, or
+ *         SETTINGS_LOAD_PARTIAL if some of it could not be applied
+ */
+SETTINGS_LoadResult SETTINGS_Load(uint32_t* sequence);
+
+/**
+ * @brief Erase the store; the next boot uses the built-in defaults
+ * @return HAL_StatusTypeDef
+ */
+HAL_StatusTypeDef SETTINGS_Erase(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_SETTINGS_H_ */
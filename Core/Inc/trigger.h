@@ -0,0 +1,66 @@
+/*
+ * trigger.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: mavorpdx
+ */
+
+#ifndef INC_TRIGGER_H_
+#define INC_TRIGGER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stm32f0xx_hal.h"
+#include "utils.h"
+
+#define TRIG_DEFAULT_WIDTH_US   10
+#define TRIG_MIN_WIDTH_US       2       // Width is -1/+0 us, so 2 keeps it above 1 us
+#define TRIG_MAX_WIDTH_US       1000000
+
+// Firmware events that can pulse P105
+typedef enum {
+    TRIG_EVT_CMD,       // Host command about to run
+    TRIG_EVT_ADC,       // ADC scan about to start
+    TRIG_EVT_SEQ,       // Sequencer step written
+    TRIG_EVT_MATCH,     // UART watch pattern matched (BOOTTIME, CYCLE)
+    TRIG_EVT_MANUAL,    // TRIG_PULSE
+    TRIG_EVT_COUNT
+} TRIG_Event;
+
+/**
+ * @brief Put P105 on TIM2_CH1 and set which events pulse it
+ * @param mask: Bit per TRIG_Event, 0 for none (TRIG_PULSE still works)
+ * @param width_us: Pulse width
+ * @param active_low: Idle high, pulse low
+ * @return HAL_OK, or HAL_ERROR on a bad width
+ */
+HAL_StatusTypeDef TRIG_Configure(uint32_t mask, uint32_t width_us, bool active_low);
+
+/**
+ * @brief Give P105 back to the GPIO table as a plain output (driven low)
+ */
+void TRIG_Release(void);
+
+/**
+ * @brief Pulse P105 if the event is enabled, safe from any interrupt
+ */
+void TRIG_Fire(TRIG_Event event);
+
+/**
+ * @brief Parse an event list like "CMD,SEQ", "ALL" or "NONE"
+ * @return HAL_OK, or HAL_ERROR on an unknown name
+ */
+HAL_StatusTypeDef TRIG_ParseEvents(char* list, uint32_t* mask);
+
+/**
+ * @brief Print mode, events, width and per-event counts
+ */
+void TRIG_PrintStatus(char* buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_TRIGGER_H_ */
@@ -19,11 +19,24 @@ extern "C" {
 #define UART_TIMEOUT 1000
 
 #define UART_BUFFER_SIZE 1024
-#define CMD_BUFFER_SIZE 32
-#define LAST_CMD_BUFFER_SIZE  CMD_BUFFER_SIZE
+#define CMD_BUFFER_SIZE 320     // Fits I2C_REGS_LOAD with 128 bytes of hex
+#define LAST_CMD_BUFFER_SIZE  128   // Longer commands are not kept for the up-arrow recall
 
 extern char cmdBuffer[CMD_BUFFER_SIZE];
 
+#define UART_WATCH_MAX_PATTERN  32      // Longest BOOTTIME banner
+#define BOOT_RESET_WIDTH_US     10000   // BOOTTIME reset pulse when none is given
+#define BOOT_RESET_WIDTH_MAX_US 1000000 // Longest BOOTTIME reset pulse, it is timed with the main loop held
+#define BOOT_TIMEOUT_MAX_MS     60000
+
+// Result of a BOOTTIME run, times in us from the reset release
+typedef struct {
+    uint32_t width_us;                  // Measured reset pulse width
+    bool first_seen;                    // A byte arrived before the timeout
+    uint32_t first_us;                  // First received byte
+    uint32_t boot_us;                   // Banner match (or first byte with no banner)
+} UART_BootResult;
+
 typedef struct {
     uint8_t buffer[UART_BUFFER_SIZE];
     volatile uint16_t head;
@@ -68,6 +81,17 @@ void handleSerialCommunications(void);
 void handleCommandPort(void);
 void handleDataPorts(void);
 
+UART_HandleTypeDef* UART_FindPort(const char* name);
+HAL_StatusTypeDef UART_WatchStart(UART_HandleTypeDef* huart, const char* pattern);
+void UART_WatchStop(void);
+bool UART_WatchActive(void);
+bool UART_WatchFirst(uint32_t* when_us);
+bool UART_WatchDone(uint32_t* when_us);
+HAL_StatusTypeDef UART_BootStart(const GPIO_PinConfig* reset, uint32_t width_us,
+                                 UART_HandleTypeDef* huart, const char* pattern,
+                                 uint32_t timeout_ms);
+void UART_BootProcess(void);
+
 void handleRS485Communication(void);
 void RS485_EnableTransmit(void);
 void RS485_EnableReceive(void);
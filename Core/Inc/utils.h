@@ -18,6 +18,9 @@
 #define millis()        HAL_GetTick()
 #define delay(ms)       HAL_Delay(ms)
 
+// Free-running 1 MHz timebase on TIM2 (32-bit, wraps every ~71 minutes)
+#define micros()        (TIM2->CNT)
+
 extern uint32_t previous_led_millis;
 extern uint8_t serialCFG;
 extern char tStr[];
@@ -35,8 +38,10 @@ extern uint8_t DEBUG_UART;
 extern uint8_t controllerType;
 
 void Error_Handler(void);
+void Micros_Init(void);
 void str2upper(char* str);
 uint32_t str2num(const char *data);
+int hex2bytes(const char *hex, uint8_t *out, int max_len);
 
 #ifdef  USE_FULL_ASSERT
 void assert_failed(uint8_t *file, uint32_t line);
@@ -14,6 +14,7 @@
 #include "adc.h"
 #include "main.h"
 #include "command.h"
+#include "trigger.h"
 
 ADC_HandleTypeDef hadc;     // ADC handle
 
@@ -51,43 +52,43 @@ static const uint32_t adc_channels[ADC_CHANNEL_COUNT] = {
 
 
 
+// Channel order of adc_channels[], until a profile sets its own table
+static const ADC_Scale adc_default_scale[ADC_CHANNEL_COUNT] = {
+    { ADC_V_INV_J2, ADC_V_INV_J2DIV, 0, 0 },
+    { ADC_V_MAIN_J2, ADC_V_MAIN_J2DIV, 0, 0 },
+    { ADC_V_INV_REG_12v, ADC_V_INV_REG_12vDIV, 0, 0 },
+    { ADC_3V3_PERI, ADC_3V3_PERIDIV, 0, 0 },
+    { ADC_5C_J13, ADC_5C_J13DIV, 0, 0 },
+};
+
+static const ADC_Scale* adc_scale = adc_default_scale;
+
+/**
+ * @brief Use another scale table, in adc_channels[] order
+ * @param scale: ADC_CHANNEL_COUNT entries, must stay valid; NULL restores the defaults
+ */
+void ADC_SetScale(const ADC_Scale* scale) {
+	adc_scale = scale ? scale : adc_default_scale;
+	processADCValues();
+}
+
+/**
+ * @brief " LOW" or " HIGH" when a calculated value is outside its window, "" otherwise
+ */
+const char* ADC_LimitFlag(int channel) {
+	const ADC_Scale* scale = &adc_scale[channel];
+
+	if (scale->max_mv == 0) return "";
+	if (adc_calculated_values[channel] < scale->min_mv) return " LOW";
+	if (adc_calculated_values[channel] > scale->max_mv) return " HIGH";
+	return "";
+}
+
 // Function to process ADC values using custom calculations
 void processADCValues(void) {
-	//printf("!");
     for (int i = 0; i < ADC_CHANNEL_COUNT; i++) {
-    	switch (i)
-    	{
-    	case 0:
-    		//if(DEBUG_ADC) printf("ADC[%d] raw=%d mult=%d div=%d\n", i, adc_raw_values[i], ADC_V_INV_J2, ADC_V_INV_J2DIV);
-        	adc_calculated_values[0] = (adc_raw_values[0] * ADC_V_INV_J2) / ADC_V_INV_J2DIV;
-    		break;
-
-    	case 1:
-    		//if(DEBUG_ADC) printf("ADC[%d] raw=%d mult=%d div=%d\n", i, adc_raw_values[i], ADC_V_MAIN_J2, ADC_V_MAIN_J2DIV);
-        	adc_calculated_values[1] = (adc_raw_values[1] * ADC_V_MAIN_J2) / ADC_V_MAIN_J2DIV;
-    		break;
-
-    	case 2:
-    		//if(DEBUG_ADC) printf("ADC[%d] raw=%d mult=%d div=%d\n", i, adc_raw_values[i], ADC_V_INV_REG_12v, ADC_V_INV_REG_12vDIV);
-        	adc_calculated_values[2] = (adc_raw_values[2] * ADC_V_INV_REG_12v) / ADC_V_INV_REG_12vDIV;
-    		break;
-
-    	case 3:
-    		//printf("ADC[%d] raw=%d mult=%d div=%d  calc=%d\n", i, adc_raw_values[i], ADC_3V3_PERI, ADC_3V3_PERIDIV, (adc_raw_values[3] * ADC_3V3_PERI) / ADC_3V3_PERIDIV);
-        	adc_calculated_values[3] = (adc_raw_values[3] * ADC_3V3_PERI) / ADC_3V3_PERIDIV;
-    		break;
-
-    	case 4:
-    		//if(DEBUG_ADC) printf("ADC[%d] raw=%d mult=%d div=%d\n", i, adc_raw_values[i], ADC_5C_J13, ADC_5C_J13DIV);
-        	adc_calculated_values[4] = (adc_raw_values[4] * ADC_5C_J13) / ADC_5C_J13DIV;
-    		break;
-
-    	default:
-    		if(DEBUG_ADC) printf("OOPS - ran over the ADC Case Count\n");
-    		break;
-    	}
+        adc_calculated_values[i] = (adc_raw_values[i] * adc_scale[i].mult) / adc_scale[i].div;
     }
-    //printf("@");
 }
 
 // Functions to get raw ADC values
@@ -151,15 +152,15 @@ void printADCCalc(char *buffer)
 {
 	strcat(buffer, "ADC Values\n");
 	strcat(buffer, "------------------------------\n");
-	sprintf(tStr, "INV_12V  = %ld\n", getADC_Calculated_Inverter());
+	sprintf(tStr, "INV_12V  = %ld%s\n", getADC_Calculated_Inverter(), ADC_LimitFlag(2));
 	strcat(buffer, tStr);
-	sprintf(tStr, "3V3_PERI = %ld\n", getADC_Calculated_3V3());
+	sprintf(tStr, "3V3_PERI = %ld%s\n", getADC_Calculated_3V3(), ADC_LimitFlag(3));
 	strcat(buffer, tStr);
-	sprintf(tStr, "VOLT5V0 = %ld\n", getADC_Calculated_5V_J13());
+	sprintf(tStr, "VOLT5V0 = %ld%s\n", getADC_Calculated_5V_J13(), ADC_LimitFlag(4));
 	strcat(buffer, tStr);
-	sprintf(tStr, "INV_12V_J2 = %ld\n", getADC_Calculated_Inv_J2());
+	sprintf(tStr, "INV_12V_J2 = %ld%s\n", getADC_Calculated_Inv_J2(), ADC_LimitFlag(0));
 	strcat(buffer, tStr);
-	sprintf(tStr, "MAIN_5V_J2  = %ld\n", getADC_Calculated_Main_J2());
+	sprintf(tStr, "MAIN_5V_J2  = %ld%s\n", getADC_Calculated_Main_J2(), ADC_LimitFlag(1));
 	strcat(buffer, tStr);
 }
 
@@ -264,6 +265,7 @@ void readADCValues(void) {
             while(ADC1->CFGR1 & ADC_CFGR1_WAIT);
 
             // Start the conversion
+            if (i == 0 && j == 0) TRIG_Fire(TRIG_EVT_ADC);
             ADC1->CR |= ADC_CR_ADSTART;
 
             // Wait for conversion with timeout
@@ -23,6 +23,13 @@
 #include "uart.h"
 #include "utils.h"
 #include "main.h"
+#include "sequence.h"
+#include "powercycle.h"
+#include "measure.h"
+#include "trigger.h"
+#include "settings.h"
+#include "profile.h"
+#include "config.h"
 
 int debugFlag = 0;
 
@@ -30,8 +37,20 @@ int debugFlag = 0;
 // processSerialCommand()
 // Very simple parser to handle commands entered via debug UART.
 // ******************************************************************
+// Strip a leading OA1/OA2 device selector from the data of an I2C slave command
+static I2C_SlaveDev parseSlaveDev(char** data) {
+    char* p = *data;
+
+    if (p && (p[0] == 'O' || p[0] == 'o') && (p[1] == 'A' || p[1] == 'a') &&
+        (p[2] == '1' || p[2] == '2') && (p[3] == ' ' || p[3] == '\0')) {
+        *data = p[3] ? p + 4 : NULL;
+        return p[2] == '2' ? I2C_SLAVE_DEV_OA2 : I2C_SLAVE_DEV_OA1;
+    }
+    return I2C_SLAVE_DEV_OA1;
+}
+
 void processSerialCommand(char* command, char* data) {
-	char buffer[CMD_BUFFER_SIZE];
+	char buffer[CMD_REPLY_SIZE];
 	char buff[10000] = {0};
 	char temp[12];
 
@@ -44,7 +63,19 @@ void processSerialCommand(char* command, char* data) {
 	}
 
   str2upper(command);  // Convert only command to uppercase
+
+  // Lines of a CONFIG BEGIN block are staged, not run, until END
+  if (CONFIG_BlockOpen()) {
+    if (strcmp(command, "END") == 0 || (strcmp(command, "CONFIG") == 0 && data && strcasecmp(data, "END") == 0)) {
+      CONFIG_Apply(buffer);
+      sendReply("CONFIG", buffer);
+    } else {
+      CONFIG_AddLine(command, data);
+    }
+    return;
+  }
   if(DEBUG_CMD) sendDebug(command, data ? data : "");
+  TRIG_Fire(TRIG_EVT_CMD);
 
   if (strncmp(command, "VERS", 4) == 0) {
 	  //if(DEBUG_CMD)
@@ -114,7 +145,29 @@ void processSerialCommand(char* command, char* data) {
   // ******************************************************
   // I2Cs
   // ******************************************************
-  else if (strncmp(command, "I2C_SLAVE_ADDR", 14) == 0) {
+  else if (strncmp(command, "I2C_SLAVE_ADDR2", 15) == 0) {
+      // Parse format: <addr> [mask_bits] | OFF
+      if (data) {
+        char* token = strtok(data, " ");
+        char* mask = strtok(NULL, " ");
+        uint32_t addr = strcasecmp(token, "OFF") == 0 ? 0 : str2num(token);
+        uint32_t mask_bits = mask ? str2num(mask) : 0;
+        // Checked before narrowing so 0x150 is not taken as 0x50
+        if (addr > 0x7F || mask_bits > 7 || I2C_SetSecondAddress((uint8_t)addr, (uint8_t)mask_bits) != HAL_OK) {
+          sendReply("I2C_SLAVE_ADDR2", "ERROR");
+          return;
+        }
+      }
+      uint8_t mask_bits;
+      uint8_t addr = I2C_GetSecondAddress(&mask_bits);
+      if (addr == 0) {
+        sendReply("I2C_SLAVE_ADDR2", "OFF");
+      } else {
+        sprintf(buffer, "0x%02X-0x%02X", addr, addr + (1U << mask_bits) - 1);
+        sendReply("I2C_SLAVE_ADDR2", buffer);
+      }
+    }
+    else if (strncmp(command, "I2C_SLAVE_ADDR", 14) == 0) {
       if (data) {
         uint8_t addr = (uint8_t)str2num(data);
         if (I2C_SetSlaveAddress(addr) == HAL_OK) {
@@ -128,15 +181,16 @@ void processSerialCommand(char* command, char* data) {
       }
     }
     else if (strncmp(command, "I2C_REG_SET", 11) == 0) {
-      // Parse format: <reg_addr> <value>
+      // Parse format: [OA2] <reg_addr> <value>
+      I2C_SlaveDev dev = parseSlaveDev(&data);
       if (data) {
         char* token = strtok(data, " ");
         if (token != NULL) {
-          uint8_t reg_addr = (uint8_t)str2num(token);
+          uint16_t reg_addr = (uint16_t)str2num(token);
           token = strtok(NULL, " ");
           if (token != NULL) {
             uint8_t value = (uint8_t)str2num(token);
-            if (I2C_SetRegisterValue(reg_addr, value) == HAL_OK) {
+            if (I2C_SetRegisterValue(dev, reg_addr, value) == HAL_OK) {
               sprintf(buffer, "Reg 0x%02X = 0x%02X", reg_addr, value);
               sendReply("I2C_REG_SET", buffer);
             } else {
@@ -153,10 +207,11 @@ void processSerialCommand(char* command, char* data) {
       }
     }
     else if (strncmp(command, "I2C_REG_GET", 11) == 0) {
+      I2C_SlaveDev dev = parseSlaveDev(&data);
       if (data) {
-        uint8_t reg_addr = (uint8_t)str2num(data);
+        uint16_t reg_addr = (uint16_t)str2num(data);
         uint8_t value;
-        if (I2C_GetRegisterValue(reg_addr, &value) == HAL_OK) {
+        if (I2C_GetRegisterValue(dev, reg_addr, &value) == HAL_OK) {
           sprintf(buffer, "Reg 0x%02X = 0x%02X", reg_addr, value);
           sendReply("I2C_REG_GET", buffer);
         } else {
@@ -166,9 +221,173 @@ void processSerialCommand(char* command, char* data) {
         sendReply("I2C_REG_GET", "Missing register address");
       }
     }
+    else if (strncmp(command, "I2C_REGS_SIZE", 13) == 0) {
+      I2C_SlaveDev dev = parseSlaveDev(&data);
+      if (data) {
+        if (I2C_SetRegisterFileSize(dev, (uint16_t)str2num(data)) != HAL_OK) {
+          sendReply("I2C_REGS_SIZE", "ERROR");
+          return;
+        }
+      }
+      sprintf(buffer, "%u", I2C_GetRegisterFileSize(dev));
+      sendReply("I2C_REGS_SIZE", buffer);
+    }
+    else if (strncmp(command, "I2C_REGS_LOAD", 13) == 0) {
+      // Parse format: [OA2] <start> <hex bytes>
+      I2C_SlaveDev dev = parseSlaveDev(&data);
+      char* token = data ? strtok(data, " ") : NULL;
+      char* hex = token ? strtok(NULL, "") : NULL;
+      uint8_t values[I2C_REG_FILE_MAX];
+      int count = hex ? hex2bytes(hex, values, sizeof(values)) : -1;
+
+      if (count <= 0) {
+        sendReply("I2C_REGS_LOAD", "Usage: I2C_REGS_LOAD [OA2] <start> <hex bytes>");
+      } else if (I2C_LoadRegisters(dev, (uint16_t)str2num(token), values, (uint16_t)count) != HAL_OK) {
+        sendReply("I2C_REGS_LOAD", "ERROR");
+      } else {
+        sprintf(buffer, "%u bytes at 0x%02X", count, (unsigned int)str2num(token));
+        sendReply("I2C_REGS_LOAD", buffer);
+      }
+    }
+    else if (strncmp(command, "I2C_REGS_DUMP", 13) == 0) {
+      // Parse format: [OA2] [start] [count], default the whole map
+      I2C_SlaveDev dev = parseSlaveDev(&data);
+      char* token = data ? strtok(data, " ") : NULL;
+      uint16_t start = token ? (uint16_t)str2num(token) : 0;
+      token = token ? strtok(NULL, " ") : NULL;
+      uint16_t count = token ? (uint16_t)str2num(token) : I2C_GetRegisterFileSize(dev) - start;
+
+      if (start >= I2C_GetRegisterFileSize(dev) || I2C_DumpRegisters(dev, buff, start, count) != HAL_OK) {
+        sendReply("I2C_REGS_DUMP", "ERROR");
+      } else {
+        sendReply("I2C_REGS_DUMP", buff);
+      }
+    }
+    else if (strncmp(command, "I2C_EEPROM", 10) == 0) {
+      // Parse format: [OA2] OFF | 24C01..24C08 [write_ms] | <size> <addr_bytes> <page> [write_ms]
+      I2C_SlaveDev dev = parseSlaveDev(&data);
+      char* token = data ? strtok(data, " ") : NULL;
+      HAL_StatusTypeDef status = HAL_OK;
+
+      if (token && strcasecmp(token, "OFF") == 0) {
+        status = I2C_SetEepromMode(dev, NULL);
+      } else if (token) {
+        I2C_EepromConfig config = { 0, 1, 8, I2C_EEPROM_DEFAULT_WRITE_MS };
+        char* write_ms = NULL;
+
+        if (strcasecmp(token, "24C01") == 0) {
+          config.size = 128;
+          write_ms = strtok(NULL, " ");
+        } else if (strcasecmp(token, "24C02") == 0) {
+          config.size = 256;
+          write_ms = strtok(NULL, " ");
+        } else if (strcasecmp(token, "24C04") == 0 || strcasecmp(token, "24C08") == 0) {
+          // Block select in the address: needs OA2 with 1 or 2 mask bits
+          config.size = token[4] == '4' ? 512 : 1024;
+          config.page = 16;
+          write_ms = strtok(NULL, " ");
+        } else {
+          char* addr_bytes = strtok(NULL, " ");
+          char* page = strtok(NULL, " ");
+          config.size = (uint16_t)str2num(token);
+          config.addr_bytes = addr_bytes ? (uint8_t)str2num(addr_bytes) : 0;
+          config.page = page ? (uint8_t)str2num(page) : 0;
+          write_ms = strtok(NULL, " ");
+        }
+        if (write_ms) {
+          config.write_ms = (uint16_t)str2num(write_ms);
+        }
+        status = I2C_SetEepromMode(dev, &config);
+      }
+
+      if (status != HAL_OK) {
+        sendReply("I2C_EEPROM", "ERROR");
+      } else {
+        I2C_PrintEepromStatus(dev, buffer);
+        sendReply("I2C_EEPROM", buffer);
+      }
+    }
     else if (strncmp(command, "I2C_STATUS", 10) == 0) {
       I2C_PrintSlaveStatus();
     }
+    else if (strncmp(command, "I2C_STATS", 9) == 0) {
+      if (data && strncmp(data, "CLR", 3) == 0) {
+        I2C_ClearStats();
+        sendReply("I2C_STATS", "OK");
+      } else {
+        I2C_PrintStats(buff);
+        sendReply("I2C_STATS", buff);
+      }
+    }
+    else if (strncmp(command, "I2C_LOG", 7) == 0) {
+      if (data && strncmp(data, "CLR", 3) == 0) {
+        I2C_ClearSlaveLog();
+        sendReply("I2C_LOG", "OK");
+      } else {
+        I2C_PrintSlaveLog(buff);
+        sendReply("I2C_LOG", buff);
+      }
+    }
+    else if (strncmp(command, "I2C_INJECT", 10) == 0) {
+      // Parse format: OFF | [STRETCH <us> [R|W|RW]] [NACK <byte>], replaces all settings
+      if (data) {
+        I2C_SlaveInject inject = { .nack_byte = I2C_INJECT_NACK_OFF };
+        HAL_StatusTypeDef status = HAL_OK;
+        char* token = strtok(data, " ");
+
+        while (token != NULL && status == HAL_OK) {
+          char* value = strtok(NULL, " ");
+          if (strcasecmp(token, "OFF") == 0) {
+            token = value;
+          } else if (strcasecmp(token, "STRETCH") == 0 && value) {
+            inject.stretch_us = strtoul(value, NULL, 10);
+            inject.stretch_read = true;
+            inject.stretch_write = true;
+            token = strtok(NULL, " ");
+            if (token && (strcasecmp(token, "R") == 0 || strcasecmp(token, "W") == 0 ||
+                          strcasecmp(token, "RW") == 0)) {
+              inject.stretch_read = (strchr(token, 'R') || strchr(token, 'r'));
+              inject.stretch_write = (strchr(token, 'W') || strchr(token, 'w'));
+              token = strtok(NULL, " ");
+            }
+          } else if (strcasecmp(token, "NACK") == 0 && value) {
+            inject.nack_byte = (uint16_t)str2num(value);
+            token = strtok(NULL, " ");
+          } else {
+            status = HAL_ERROR;
+          }
+        }
+        if (status != HAL_OK || I2C_SetSlaveInject(&inject) != HAL_OK) {
+          sendReply("I2C_INJECT", "ERROR");
+          return;
+        }
+      }
+      I2C_PrintSlaveInject(buff);
+      sendReply("I2C_INJECT", buff);
+    }
+    else if (strncmp(command, "I2C_SPEED", 9) == 0) {
+      if (data && I2C_MasterSetSpeed(strtoul(data, NULL, 10)) != HAL_OK) {
+        sendReply("I2C_SPEED", "ERROR");
+      } else {
+        sprintf(buffer, "%lu", (unsigned long)I2C_MasterGetSpeed());
+        sendReply("I2C_SPEED", buffer);
+      }
+    }
+    else if (strncmp(command, "I2C_SLAVE_SPEED", 15) == 0) {
+      if (data && I2C_SlaveSetSpeed(strtoul(data, NULL, 10)) != HAL_OK) {
+        sendReply("I2C_SLAVE_SPEED", "ERROR");
+      } else {
+        sprintf(buffer, "%lu", (unsigned long)I2C_SlaveGetSpeed());
+        sendReply("I2C_SLAVE_SPEED", buffer);
+      }
+    }
+    else if (strncmp(command, "I2C_BENCH", 9) == 0) {
+      // Answered from I2C_Process() once per second
+      HAL_StatusTypeDef status = I2C_SlaveBenchStart(data ? strtoul(data, NULL, 10) : 1);
+      if (status != HAL_OK) {
+        sendReply("I2C_BENCH", status == HAL_BUSY ? "BUSY" : "ERROR");
+      }
+    }
 
 
   // ******************************************************
@@ -180,6 +399,184 @@ void processSerialCommand(char* command, char* data) {
   else if (strncmp(command, "GPIODETAILS", 11) == 0) {
 	  GPIO_PrintDetailedInfo(buff);
   }
+  else if (strncmp(command, "PCA_DIR", 7) == 0) {
+    char* name = data ? strtok(data, " ") : NULL;
+    char* dir = name ? strtok(NULL, " ") : NULL;
+    str2upper(dir);
+    if (name == NULL || (dir && (strcmp(dir, "IN") == 0 || strcmp(dir, "OUT") == 0) &&
+                         GPIO_SetPCADirection(name, dir[0] == 'I') == HAL_OK)) {
+      buffer[0] = '\0';
+      GPIO_PrintPCAStatus(buffer);
+      sendReply("PCA_DIR", buffer);
+    } else {
+      sendDebug("Usage: PCA_DIR [<pca_pin> <IN|OUT>]", "");
+    }
+  }
+  else if (strncmp(command, "GPIO_WRITE", 10) == 0) {
+    // Parse format: <pin>=<0|1> [<pin>=<0|1> ...]
+    if (data) {
+      GPIO_PinWrite writes[GPIO_WRITE_MAX_PINS];
+      int count = 0;
+      bool ok = true;
+      char* token = strtok(data, " ,");
+      while (token != NULL) {
+        char* eq = strchr(token, '=');
+        if (eq == NULL || count >= GPIO_WRITE_MAX_PINS) {
+          ok = false;
+          break;
+        }
+        *eq = '\0';
+        writes[count].config = GPIO_FindByName(token);
+        if (writes[count].config == NULL) {
+          ok = false;
+          break;
+        }
+        // Only 0 and 1: a typo must not drive the pin low
+        if (strcmp(eq + 1, "0") != 0 && strcmp(eq + 1, "1") != 0) {
+          *eq = '=';
+          ok = false;
+          break;
+        }
+        writes[count].state = (eq[1] == '1') ? GPIO_PIN_SET : GPIO_PIN_RESET;
+        count++;
+        token = strtok(NULL, " ,");
+      }
+      if (ok && GPIO_WritePins(writes, count) == HAL_OK) {
+        sprintf(buffer, "OK %d", count);
+        sendReply("GPIO_WRITE", buffer);
+      } else {
+        sendReply("GPIO_WRITE", token ? token : "ERROR");
+      }
+    } else {
+      sendDebug("Usage: GPIO_WRITE <pin>=<0|1> ...", "");
+    }
+  }
+  else if (strncmp(command, "PG_TIME", 7) == 0) {
+    char* out_name = data ? strtok(data, " ") : NULL;
+    char* in_name = out_name ? strtok(NULL, " ") : NULL;
+    char* timeout = in_name ? strtok(NULL, " ") : NULL;
+    char* eq = out_name ? strchr(out_name, '=') : NULL;
+    if (eq && strcmp(eq + 1, "0") != 0 && strcmp(eq + 1, "1") != 0) {
+      sendReply("PG_TIME", "ERROR");
+    } else if (in_name) {
+      GPIO_PinState level = GPIO_PIN_SET;
+      if (eq) {
+        *eq = '\0';
+        level = (eq[1] == '1') ? GPIO_PIN_SET : GPIO_PIN_RESET;
+      }
+      uint32_t timeout_ms = timeout ? strtoul(timeout, NULL, 10) : PG_TIME_DEFAULT_MS;
+      if (timeout_ms == 0 || timeout_ms > PG_TIME_MAX_MS) timeout_ms = PG_TIME_MAX_MS;
+
+      // Answered here or, for a slow rail, from GPIO_ProcessResponse()
+      HAL_StatusTypeDef status = GPIO_StartResponse(GPIO_FindByName(out_name), level, GPIO_FindInputByName(in_name),
+                                                    level == GPIO_PIN_SET, timeout_ms * 1000);
+      if (status != HAL_OK) {
+        sendReply("PG_TIME", status == HAL_BUSY ? "BUSY" : "ERROR");
+      }
+    } else {
+      sendDebug("Usage: PG_TIME <enable>[=0|1] <power_good> [timeout_ms]", "");
+    }
+  }
+  else if (strncmp(command, "WAIT", 4) == 0) {
+    char* name = data ? strtok(data, " ") : NULL;
+    char* state = name ? strtok(NULL, " ") : NULL;
+    char* timeout = state ? strtok(NULL, " ") : NULL;
+    str2upper(state);
+    if (timeout && (strcmp(state, "ACTIVE") == 0 || strcmp(state, "INACTIVE") == 0)) {
+      HAL_StatusTypeDef status = GPIO_StartWait(name, state[0] == 'A', strtoul(timeout, NULL, 10));
+      if (status != HAL_OK) {
+        sendReply("WAIT", status == HAL_BUSY ? "BUSY" : "ERROR");
+      }
+    } else {
+      sendDebug("Usage: WAIT <input> <ACTIVE|INACTIVE> <timeout_ms>", "");
+    }
+  }
+  else if (strncmp(command, "TRIG_PULSE", 10) == 0) {
+    TRIG_Fire(TRIG_EVT_MANUAL);
+    sendReply("TRIG_PULSE", "OK");
+  }
+  else if (strncmp(command, "TRIG", 4) == 0) {
+    char* events = data ? strtok(data, " ") : NULL;
+    char* width = events ? strtok(NULL, " ") : NULL;
+    char* polarity = width ? strtok(NULL, " ") : NULL;
+    uint32_t mask;
+    str2upper(events);
+    str2upper(polarity);
+    if (events == NULL) {
+      TRIG_PrintStatus(buff);
+      sendReply("TRIG", buff);
+    } else if (strcmp(events, "OFF") == 0) {
+      TRIG_Release();
+      sendReply("TRIG", "OFF");
+    } else if (TRIG_ParseEvents(events, &mask) == HAL_OK &&
+               (polarity == NULL || strcmp(polarity, "HIGH") == 0 || strcmp(polarity, "LOW") == 0) &&
+               TRIG_Configure(mask, width ? strtoul(width, NULL, 10) : TRIG_DEFAULT_WIDTH_US,
+                              polarity && strcmp(polarity, "LOW") == 0) == HAL_OK) {
+      TRIG_PrintStatus(buff);
+      sendReply("TRIG", buff);
+    } else {
+      sendDebug("Usage: TRIG [<CMD,ADC,SEQ,MATCH|ALL|NONE|OFF> [width_us] [HIGH|LOW]]", "");
+    }
+  }
+  else if (strncmp(command, "MEASURE", 7) == 0) {
+    // Answered from MEASURE_Process() when the gate closes
+    HAL_StatusTypeDef status = MEASURE_Start(data ? strtoul(data, NULL, 10) : 0);
+    if (status != HAL_OK) {
+      sendReply("MEASURE", status == HAL_BUSY ? "BUSY" : "ERROR");
+    }
+  }
+  else if (strncmp(command, "CYCLE_STOP", 10) == 0) {
+    CYCLE_Stop();
+    sendReply("CYCLE_STOP", "OK");
+  }
+  else if (strncmp(command, "CYCLE", 5) == 0) {
+    char* count = data ? strtok(data, " ") : NULL;
+    char* enables = count ? strtok(NULL, " ") : NULL;
+    char* pg_name = enables ? strtok(NULL, " ") : NULL;
+    char* port_name = pg_name ? strtok(NULL, " ") : NULL;
+    char* pattern = port_name ? strtok(NULL, " ") : NULL;
+    char* off_ms = pattern ? strtok(NULL, " ") : NULL;
+    char* timeout_ms = off_ms ? strtok(NULL, " ") : NULL;
+
+    if (pattern) {
+      CYCLE_Config config = {0};
+      bool ok = strlen(pattern) <= UART_WATCH_MAX_PATTERN;
+
+      config.cycles = strtoul(count, NULL, 10);
+      config.off_ms = off_ms ? strtoul(off_ms, NULL, 10) : CYCLE_DEFAULT_OFF_MS;
+      config.timeout_ms = timeout_ms ? strtoul(timeout_ms, NULL, 10) : CYCLE_DEFAULT_TIMEOUT_MS;
+
+      // Enables are a comma separated list
+      for (char* name = enables; ok && name && *name; ) {
+        char* comma = strchr(name, ',');
+        if (comma) *comma = '\0';
+        const GPIO_PinConfig* pin = GPIO_FindByName(name);
+        if (pin == NULL || config.enable_count >= CYCLE_MAX_ENABLES) {
+          ok = false;
+        } else {
+          config.enables[config.enable_count++] = pin;
+        }
+        name = comma ? comma + 1 : NULL;
+      }
+      if (strcmp(pg_name, "-") != 0) {
+        config.power_good = GPIO_FindInputByName(pg_name);
+        ok = ok && config.power_good != NULL && config.power_good->type == GPIO_TYPE_MCU;
+      }
+      if (strcmp(port_name, "-") != 0) {
+        config.port = UART_FindPort(port_name);
+        ok = ok && config.port != NULL;
+      }
+      if (ok && strcmp(pattern, "-") != 0) {
+        strcpy(config.pattern, pattern);
+      }
+
+      HAL_StatusTypeDef status = ok ? CYCLE_Start(&config) : HAL_ERROR;
+      sendReply("CYCLE", status == HAL_OK ? "STARTED" : (status == HAL_BUSY ? "BUSY" : "ERROR"));
+    } else {
+      CYCLE_PrintStatus(buff);
+      sendReply("CYCLE", buff);
+    }
+  }
   else if (strncmp(command, "TOGGLE", 6) == 0) {
     if (data) {
       if( (GPIO_ToggleByName(data)) == HAL_OK) {
@@ -240,11 +637,138 @@ void processSerialCommand(char* command, char* data) {
       sendDebug("Usage: INPUT <pin_name>", "");
     }
   }
+  else if (strncmp(command, "DEBOUNCE", 8) == 0) {
+    // Parse format: <pin_name> [window_us]
+    if (data) {
+      char* name = strtok(data, " ");
+      char* value = strtok(NULL, " ");
+      uint32_t window;
+      if (value != NULL) {
+        window = str2num(value);
+        if (GPIO_SetDebounce(name, window) != HAL_OK) {
+          sendReply(name, "ERROR");
+          return;
+        }
+      } else if (GPIO_GetDebounce(name, &window) != HAL_OK) {
+        sendReply(name, "ERROR");
+        return;
+      }
+      sprintf(buffer, "%lu", (unsigned long)window);
+      sendReply(name, buffer);
+    } else {
+      sendDebug("Usage: DEBOUNCE <pin_name> [window_us]", "");
+    }
+  }
+  else if (strncmp(command, "GLITCHES", 8) == 0) {
+    str2upper(data);
+    if (data && strncmp(data, "CLR", 3) == 0) {
+      GPIO_ClearGlitches();
+      sendReply("GLITCHES", "OK");
+    } else {
+      GPIO_PrintGlitches(buff);
+      sendReply("GLITCHES", buff);
+    }
+  }
+  else if (strncmp(command, "EVENTS", 6) == 0) {
+    GPIO_PrintEvents(buff);
+    sendReply("EVENTS", buff);
+  }
+  else if (strncmp(command, "EVENT_ARM", 9) == 0) {
+    if (data) {
+      sendReply(data, GPIO_ArmInputEvent(data) == HAL_OK ? "OK" : "ERROR");
+    } else {
+      sendDebug("Usage: EVENT_ARM <pin_name>", "");
+    }
+  }
+  else if (strncmp(command, "EVENT_DISARM", 12) == 0) {
+    if (data) {
+      sendReply(data, GPIO_DisarmInputEvent(data) == HAL_OK ? "OK" : "ERROR");
+    } else {
+      sendDebug("Usage: EVENT_DISARM <pin_name>", "");
+    }
+  }
+  else if (strncmp(command, "EVENT_PUSH", 10) == 0) {
+    str2upper(data);
+    if (data == NULL) {
+      sendReply("EVENT_PUSH", GPIO_GetEventPush() ? "ON" : "OFF");
+    }
+    else if (strncmp(data, "ON", 2) == 0 || strncmp(data, "1", 1) == 0) {
+      GPIO_SetEventPush(true);
+      sendReply("EVENT_PUSH", "ON");
+    }
+    else if (strncmp(data, "OFF", 3) == 0 || strncmp(data, "0", 1) == 0) {
+      GPIO_SetEventPush(false);
+      sendReply("EVENT_PUSH", "OFF");
+    }
+    else {
+      sendDebug("Usage: EVENT_PUSH [ON|OFF]", "");
+    }
+  }
+
+  // ******************************************************
+  // Sequencer
+  // ******************************************************
+  else if (strncmp(command, "SEQ_LOAD", 8) == 0 || strncmp(command, "SEQ_ADD", 7) == 0) {
+    if (data) {
+      char* bad = NULL;
+      // SEQ_AddSteps keeps nothing on error, so a bad SEQ_LOAD leaves an empty list, never a partial one
+      if (command[4] == 'L') SEQ_Clear();
+      if (SEQ_AddSteps(data, &bad) == HAL_OK) {
+        sendReply(command, "OK");
+      } else {
+        sendReply(command, bad ? bad : "ERROR");
+      }
+    } else {
+      sendDebug("Usage: SEQ_LOAD|SEQ_ADD <delay_us>:<pin>=<0|1> ...", "");
+    }
+  }
+  else if (strncmp(command, "SEQ_CLR", 7) == 0) {
+    SEQ_Clear();
+    sendReply("SEQ_CLR", "OK");
+  }
+  else if (strncmp(command, "SEQ_RUN", 7) == 0) {
+    if (SEQ_Run() == HAL_OK) {
+      SEQ_Print(buff);
+      sendReply("SEQ_RUN", buff);
+    } else {
+      sendReply("SEQ_RUN", "ERROR");
+    }
+  }
+  else if (strncmp(command, "SEQ", 3) == 0) {
+    SEQ_Print(buff);
+    sendReply("SEQ", buff);
+  }
 
 
   // ******************************************************
   // UARTs
   // ******************************************************
+  else if (strncmp(command, "BOOTTIME", 8) == 0) {
+    char* reset_name = data ? strtok(data, " ") : NULL;
+    char* port_name = reset_name ? strtok(NULL, " ") : NULL;
+    char* pattern = port_name ? strtok(NULL, " ") : NULL;
+    char* timeout = pattern ? strtok(NULL, " ") : NULL;
+    char* width = timeout ? strtok(NULL, " ") : NULL;
+    if (timeout && CYCLE_Running()) {
+      // The screen owns the UART watch and drives the DUT power
+      sendReply("BOOTTIME", "BUSY");
+    } else if (timeout) {
+      uint32_t timeout_ms = strtoul(timeout, NULL, 10);
+      if (timeout_ms == 0 || timeout_ms > BOOT_TIMEOUT_MAX_MS) timeout_ms = BOOT_TIMEOUT_MAX_MS;
+
+      // Answered from UART_BootProcess() once the banner is seen or the timeout passes
+      HAL_StatusTypeDef status = UART_BootStart(GPIO_FindByName(reset_name),
+                                                width ? strtoul(width, NULL, 10) : BOOT_RESET_WIDTH_US,
+                                                UART_FindPort(port_name),
+                                                strcmp(pattern, "-") == 0 ? "" : pattern,
+                                                timeout_ms);
+      if (status != HAL_OK) {
+        sendReply("BOOTTIME", status == HAL_BUSY ? "BUSY" : "ERROR");
+      }
+    } else {
+      sendDebug("Usage: BOOTTIME <reset_pin> <port> <pattern|-> <timeout_ms> [width_us]", "");
+    }
+  }
   else if (strncmp(command, "COM0", 4) == 0) {
 	if (data) {
 		UART_Transmit(&huart1, data);
@@ -279,7 +803,7 @@ void processSerialCommand(char* command, char* data) {
   else if (strncmp(command, "BAUD0", 5) == 0) {
     if (data) {
       uint32_t b = str2num(data);
-      if(b > SERIAL_BAUD_MAX) b = SERIAL_BAUD_MAX;
+      b = PROFILE_ClampBaud(PROFILE_PORT_COM0, b);
       if(b == 0) {
     	  sendDebug("Invalid Baud Rate","");
     	  return;
@@ -298,7 +822,7 @@ void processSerialCommand(char* command, char* data) {
   else if (strncmp(command, "BAUD1", 5) == 0) {
     if (data) {
       uint32_t b = str2num(data);
-      if(b > SERIAL_BAUD_MAX) b = SERIAL_BAUD_MAX;
+      b = PROFILE_ClampBaud(PROFILE_PORT_COM1, b);
       if(b == 0) {
     	  sendDebug("Invalid Baud Rate", "");
     	  return;
@@ -316,7 +840,7 @@ void processSerialCommand(char* command, char* data) {
   else if (strncmp(command, "BAUD2", 5) == 0) {
     if (data) {
       uint32_t b = str2num(data);
-      if(b > SERIAL_BAUD_MAX) b = SERIAL_BAUD_MAX;
+      b = PROFILE_ClampBaud(PROFILE_PORT_COM2, b);
       if(b == 0) {
     	  sendDebug("Invalid Baud Rate", "");
     	  return;
@@ -334,7 +858,7 @@ void processSerialCommand(char* command, char* data) {
   else if (strncmp(command, "BAUD485", 7) == 0) {
     if (data) {
       uint32_t b = str2num(data);
-      if(b > SERIAL_BAUD_MAX) b = SERIAL_BAUD_MAX;
+      b = PROFILE_ClampBaud(PROFILE_PORT_COM485, b);
       if(b == 0) {
     	  sendDebug("Invalid Baud Rate", "");
     	  return;
@@ -353,7 +877,7 @@ void processSerialCommand(char* command, char* data) {
   else if (strncmp(command, "BAUD3", 5) == 0) {
     if (data) {
       uint32_t b = str2num(data);
-      if(b > USB_BAUD) b = USB_BAUD;
+      b = PROFILE_ClampBaud(PROFILE_PORT_COM3, b);
       if(b == 0) {
     	  sendDebug("Invalid Baud Rate", "");
     	  return;
@@ -370,15 +894,17 @@ void processSerialCommand(char* command, char* data) {
 
   else if (strncmp(command, "SERCFG", 6) == 0) {
 	if (data) {
-		int num = str2num(data);
-		serialCFG = num;
+		uint32_t mode = str2num(data);
+		if (mode >= GPIO_SerialModeCount()) {
+			sendReply("SERCFG", "ERROR");
+			return;
+		}
+		serialCFG = mode;
 		setSerialCFG();
-        itoa(num, temp, 10);
-	    sendDebug("Serial cfg", temp);
-	} else {
-        itoa(serialCFG, temp, 10);
-		sendDebug("Serial cfg", temp);
 	}
+	buffer[0] = '\0';
+	GPIO_PrintSerialCFG(buffer);
+	sendReply("SERCFG", buffer);
   }
 
   // ******************************************************
@@ -392,6 +918,59 @@ void processSerialCommand(char* command, char* data) {
     printSystemStatus(buff);
     sendReply("Status", buff);
   }
+  else if (strncmp(command, "PROFILE", 7) == 0) {
+    if (data) {
+      int type = PROFILE_Find(data);
+      if (type < 0) {
+        strcpy(buffer, "ERROR unknown, use ");
+        PROFILE_PrintList(buffer);
+        sendReply("PROFILE", buffer);
+        return;
+      }
+      if (PROFILE_Select(type, true) != HAL_OK) {
+        sendReply("PROFILE", "ERROR outputs not set");
+        return;
+      }
+    }
+    buffer[0] = '\0';
+    PROFILE_Print(buffer);
+    sendReply("PROFILE", buffer);
+  }
+  else if (strncmp(command, "CONFIG", 6) == 0) {
+    if (data == NULL) {
+      sendDebug("Usage: CONFIG <key>=<value> ... | CONFIG BEGIN", "");
+    } else if (strcasecmp(data, "BEGIN") == 0) {
+      CONFIG_Begin(true);
+      sendReply("CONFIG", "BEGIN");
+    } else {
+      CONFIG_Begin(false);
+      CONFIG_AddTokens(data);
+      CONFIG_Apply(buffer);
+      sendReply("CONFIG", buffer);
+    }
+  }
+  else if (strncmp(command, "SAVE", 4) == 0) {
+    uint32_t sequence;
+    if (SETTINGS_Save(&sequence) == HAL_OK) {
+      sprintf(buffer, "OK %lu", (unsigned long)sequence);
+      sendReply("SAVE", buffer);
+    } else {
+      sendReply("SAVE", "ERROR");
+    }
+  }
+  else if (strncmp(command, "LOAD", 4) == 0) {
+    uint32_t sequence;
+    SETTINGS_LoadResult result = SETTINGS_Load(&sequence);
+    if (result == SETTINGS_LOAD_NONE) {
+      sendReply("LOAD", "NONE");
+    } else {
+      sprintf(buffer, "%s %lu", result == SETTINGS_LOAD_OK ? "OK" : "PARTIAL", (unsigned long)sequence);
+      sendReply("LOAD", buffer);
+    }
+  }
+  else if (strncmp(command, "ERASE", 5) == 0) {
+    sendReply("ERASE", SETTINGS_Erase() == HAL_OK ? "OK" : "ERROR");
+  }
 
 
   else {
@@ -436,16 +1015,49 @@ void printHelp(char *buffer) {
     strcat(buffer, "CLR <pin_name> Clear a named pin\n");
     strcat(buffer, "SET <pin_name> Set a named pin\n");
     strcat(buffer, "TOGGLE <pin_name> Toggle a named pin\n");
+    strcat(buffer, "GPIO_WRITE <pin>=<0|1> ... Set several pins at once\n");
+    strcat(buffer, "PG_TIME <en>[=0|1] <pg> [ms] Time enable to power-good edge in us\n");
+    strcat(buffer, "CYCLE <n> <en,..> <pg|-> <port|-> <banner|-> [off_ms] [ms] Power-cycle screen\n");
+    strcat(buffer, "CYCLE Show power-cycle progress and statistics\n");
+    strcat(buffer, "CYCLE_STOP End the power-cycle screen and report\n");
     strcat(buffer, "READ <pin_name> Read raw active state (TRUE/FALSE)\n");
     strcat(buffer, "INPUT_ALL Read all input pins\n");
     strcat(buffer, "INPUT <pin_name> Read a specific input pin\n");
+    strcat(buffer, "WAIT <pin_name> <ACTIVE|INACTIVE> <ms> Reply when the input gets there\n");
+    strcat(buffer, "MEASURE [window_ms] Frequency, duty and pulse widths on P104\n");
+    strcat(buffer, "TRIG [<events|NONE|OFF> [us] [HIGH|LOW]] Pulse P105 on CMD,ADC,SEQ,MATCH\n");
+    strcat(buffer, "TRIG_PULSE Pulse P105 now\n");
     strcat(buffer, "GPIODETAILS Print Detailed Info on pins\n");
+    strcat(buffer, "PCA_DIR [<pca_pin> <IN|OUT>] Set/show PCA9534 pin direction and input cache\n");
+    strcat(buffer, "DEBOUNCE <pin_name> [us] Set/show input debounce window\n");
+    strcat(buffer, "GLITCHES [CLR] Show/clear debounced states and glitch counts\n");
+    strcat(buffer, "EVENTS Dump and clear input change events\n");
+    strcat(buffer, "EVENT_ARM <pin_name> Log edges on an input\n");
+    strcat(buffer, "EVENT_DISARM <pin_name> Stop logging edges on an input\n");
+    strcat(buffer, "EVENT_PUSH [ON/OFF] Set/show sending events to the host as they happen\n");
+    strcat(buffer, "\n----------------------------------------------\n");
+    strcat(buffer, "SEQ_LOAD <us>:<pin>=<0|1> ... Replace the step list\n");
+    strcat(buffer, "SEQ_ADD <us>:<pin>=<0|1> ... Append steps\n");
+    strcat(buffer, "SEQ_CLR Remove all steps\n");
+    strcat(buffer, "SEQ_RUN Play the steps and report actual timings\n");
+    strcat(buffer, "SEQ Show the step list\n");
     strcat(buffer, "\n----------------------------------------------\n");
     strcat(buffer, "I2C_SLAVE <value> Response value\n");
     strcat(buffer, "I2C_SLAVE_ADDR <addr> Set I2C slave address (0-127)\n");
-    strcat(buffer, "I2C_REG_SET <reg> <val> Set register value\n");
-    strcat(buffer, "I2C_REG_GET <reg> Get register value\n");
+    strcat(buffer, "I2C_SLAVE_ADDR2 [<addr> [mask_bits]|OFF] Set/show second address or range\n");
+    strcat(buffer, "I2C_REG_SET [OA2] <reg> <val> Set register value\n");
+    strcat(buffer, "I2C_REG_GET [OA2] <reg> Get register value\n");
+    strcat(buffer, "I2C_REGS_SIZE [OA2] [n] Set/show slave register map size\n");
+    strcat(buffer, "I2C_REGS_LOAD [OA2] <start> <hex> Load registers from a hex string\n");
+    strcat(buffer, "I2C_REGS_DUMP [OA2] [start] [count] Dump registers as a hex string\n");
+    strcat(buffer, "I2C_EEPROM [OA2] [OFF|24C01..24C08|<size> <1|2> <page>] [write_ms] Emulate an EEPROM\n");
     strcat(buffer, "I2C_STATUS Show I2C slave status\n");
+    strcat(buffer, "I2C_SPEED [100|400|1000] Set/show PCA9534 bus speed in kHz\n");
+    strcat(buffer, "I2C_SLAVE_SPEED [100|400|1000] Set/show I2C slave bus speed in kHz\n");
+    strcat(buffer, "I2C_BENCH [seconds] Measure I2C slave throughput per second\n");
+    strcat(buffer, "I2C_STATS [CLR] Show/clear per-bus I2C error counters\n");
+    strcat(buffer, "I2C_LOG [CLR] Dump and clear I2C slave transactions\n");
+    strcat(buffer, "I2C_INJECT [OFF|STRETCH <us> [R|W|RW]] [NACK <byte>] Inject slave faults\n");
     strcat(buffer, "\n----------------------------------------------\n");
     strcat(buffer, "LED1 ON/OFF Control LED1\n");
     strcat(buffer, "LED1 1/0 Control LED1\n");
@@ -454,9 +1066,14 @@ void printHelp(char *buffer) {
     strcat(buffer, "\n----------------------------------------------\n");
     strcat(buffer, "TXn <msg> Send message via COMn\n");
     strcat(buffer, "RS485 <msg> Send message via RS485\n");
+    strcat(buffer, "SERCFG [0|1|2] Set/show RS-232, RS-485 or TTL transceiver mode\n");
     strcat(buffer, "BAUDx <rate> Change baud rate\n");
+    strcat(buffer, "BOOTTIME <rst> <port> <banner|-> <ms> [us] Pulse reset, time DUT boot in us\n");
     strcat(buffer, "\n----------------------------------------------\n");
     strcat(buffer, "STATUS Show system status\n");
+    strcat(buffer, "PROFILE [SLCD5|SLCD43|SLCD6] Switch DUT model (ports, outputs, ADC windows, SERCFG)\n");
+    strcat(buffer, "CONFIG <key>=<value> ... Apply many settings at once; CONFIG BEGIN, lines, END for a block\n");
+    strcat(buffer, "SAVE / LOAD / ERASE Store, re-apply or erase the power-up configuration\n");
     strcat(buffer, "HELP Show this message\n");
 }
 
@@ -466,10 +1083,14 @@ void printHelp(char *buffer) {
 void printSystemStatus(char *buffer)
 {
   strcat(buffer, "\n======= System Status ========\n");
+  sprintf(tStr, "Profile: %s\n", PROFILE_Current()->name);
+  strcat(buffer, tStr);
   sprintf(tStr, "LED1: %s\n", (HAL_GPIO_ReadPin(LED1_GPIO_PORT, LED1_PIN) == GPIO_PIN_SET) ? "ON" : "OFF");
   strcat(buffer, tStr);
   sprintf(tStr, "LED2: %s\n", (HAL_GPIO_ReadPin(LED2_GPIO_PORT, LED2_PIN) == GPIO_PIN_SET) ? "ON" : "OFF");
   strcat(buffer, tStr);
+  sprintf(tStr, "PCA9534 async write errors: %lu\n", (unsigned long)hPCA.TxErrors);
+  strcat(buffer, tStr);
   printADCCalc(buffer);
   GPIO_PrintStates(buffer);
   GPIO_PrintInputStates(buffer);
@@ -0,0 +1,222 @@
+/*
+ * config.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: mavorpdx
+ *
+ * CONFIG: bulk key/value configuration in one round trip.
+ *
+ * Keys are parsed and checked into a staging batch first, either from one
+ * CONFIG line or from the lines of a CONFIG BEGIN ... END block, and the
+ * batch is then applied in one pass: rates are only re-initialised if they
+ * change and all outputs move in a single GPIO_WritePins() call. A bad key
+ * does not stop the others; it is listed with its reason in the one reply.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <strings.h>
+
+#include "main.h"
+#include "config.h"
+#include "profile.h"
+#include "uart.h"
+
+typedef struct {
+    bool block;                             // CONFIG BEGIN is collecting lines
+    uint32_t last_ms;                       // millis() of the last block line
+    GPIO_PinWrite pins[CONFIG_MAX_PINS];
+    int pin_count;
+    uint32_t baud[PROFILE_PORT_COUNT];      // 0 = not given
+    int profile;                            // -1 = not given
+    int serial_cfg;                         // -1 = not given
+    uint16_t keys;                          // Keys seen, good or bad
+    uint16_t errors;
+    bool truncated;                         // error_text ran out of room
+    char error_text[CONFIG_ERROR_TEXT];
+} CONFIG_Batch;
+
+static CONFIG_Batch batch;
+
+// Rate keys in PROFILE_Port order, named as in the BAUDx commands and dev_*.json
+static const struct {
+    const char* key;
+    PROFILE_Port port;
+} config_bauds[] = {
+    { "BAUD0", PROFILE_PORT_COM0 },
+    { "BAUD1", PROFILE_PORT_COM1 },
+    { "BAUD2", PROFILE_PORT_COM2 },
+    { "BAUD3", PROFILE_PORT_COM3 },
+    { "BAUD485", PROFILE_PORT_COM485 },
+};
+
+/* Record a failed key; the list is cut short with "..." once the text is full */
+static void CONFIG_Error(const char* key, const char* reason) {
+    size_t used = strlen(batch.error_text);
+
+    batch.errors++;
+    if (batch.truncated) {
+        return;
+    }
+    // Keep room for " ..."
+    if (used + strlen(key) + strlen(reason) + 2 + 4 < sizeof(batch.error_text)) {
+        sprintf(batch.error_text + used, " %s:%s", key, reason);
+    } else {
+        strcat(batch.error_text, " ...");
+        batch.truncated = true;
+    }
+}
+
+/* 1/0, ON/OFF, HIGH/LOW, TRUE/FALSE, SET/CLR; -1 for anything else */
+static int CONFIG_ParseLevel(const char* value) {
+    static const char* const high[] = { "1", "ON", "HIGH", "TRUE", "SET" };
+    static const char* const low[] = { "0", "OFF", "LOW", "FALSE", "CLR" };
+
+    for (size_t i = 0; value && i < sizeof(high) / sizeof(high[0]); i++) {
+        if (strcasecmp(value, high[i]) == 0) return 1;
+        if (strcasecmp(value, low[i]) == 0) return 0;
+    }
+    return -1;
+}
+
+/* Check one key and stage it */
+static void CONFIG_AddKey(const char* key, const char* value) {
+    const GPIO_PinConfig* config;
+    int level;
+
+    batch.keys++;
+    if (value == NULL || *value == '\0') {
+        CONFIG_Error(key, "value");
+        return;
+    }
+
+    for (size_t i = 0; i < sizeof(config_bauds) / sizeof(config_bauds[0]); i++) {
+        if (strcasecmp(key, config_bauds[i].key) == 0) {
+            uint32_t baud = str2num(value);
+            if (baud == 0) {
+                CONFIG_Error(key, "value");
+            } else {
+                batch.baud[config_bauds[i].port] = baud;
+            }
+            return;
+        }
+    }
+
+    if (strcasecmp(key, "SERCFG") == 0) {
+        uint32_t mode = str2num(value);
+        if (mode >= GPIO_SerialModeCount() || (mode == 0 && strcmp(value, "0") != 0)) {
+            CONFIG_Error(key, "value");
+        } else {
+            batch.serial_cfg = mode;
+        }
+        return;
+    }
+
+    if (strcasecmp(key, "PROFILE") == 0) {
+        batch.profile = PROFILE_Find(value);
+        if (batch.profile < 0) {
+            CONFIG_Error(key, "value");
+        }
+        return;
+    }
+
+    config = GPIO_FindByName(key);
+    if (config == NULL) {
+        CONFIG_Error(key, "unknown");
+        return;
+    }
+    level = CONFIG_ParseLevel(value);
+    if (level < 0) {
+        CONFIG_Error(key, "value");
+        return;
+    }
+    // A repeated pin keeps one slot, the last value wins
+    for (int i = 0; i < batch.pin_count; i++) {
+        if (batch.pins[i].config == config) {
+            batch.pins[i].state = level ? GPIO_PIN_SET : GPIO_PIN_RESET;
+            return;
+        }
+    }
+    if (batch.pin_count >= CONFIG_MAX_PINS) {
+        CONFIG_Error(key, "full");
+        return;
+    }
+    batch.pins[batch.pin_count].config = config;
+    batch.pins[batch.pin_count].state = level ? GPIO_PIN_SET : GPIO_PIN_RESET;
+    batch.pin_count++;
+}
+
+void CONFIG_Begin(bool block) {
+    memset(&batch, 0, sizeof(batch));
+    batch.profile = -1;
+    batch.serial_cfg = -1;
+    batch.block = block;
+    batch.last_ms = millis();
+}
+
+void CONFIG_AddTokens(char* text) {
+    char* token = strtok(text, " ,");
+
+    while (token != NULL) {
+        char* eq = strchr(token, '=');
+        if (eq == NULL) {
+            batch.keys++;
+            CONFIG_Error(token, "value");
+        } else {
+            *eq = '\0';
+            CONFIG_AddKey(token, eq + 1);
+        }
+        token = strtok(NULL, " ,");
+    }
+}
+
+void CONFIG_AddLine(char* command, char* data) {
+    batch.last_ms = millis();
+
+    if (strchr(command, '=') != NULL) {
+        // KEY=VALUE tokens; the first one was split off as the command
+        CONFIG_AddTokens(command);
+        if (data) CONFIG_AddTokens(data);
+    } else if (strcmp(command, "SET") == 0 && data) {
+        CONFIG_AddKey(data, "1");
+    } else if (strcmp(command, "CLR") == 0 && data) {
+        CONFIG_AddKey(data, "0");
+    } else {
+        CONFIG_AddKey(command, data);
+    }
+}
+
+bool CONFIG_BlockOpen(void) {
+    if (batch.block && millis() - batch.last_ms > CONFIG_BLOCK_TIMEOUT_MS) {
+        if(DEBUG_CMD) printf("CONFIG block dropped after %u ms without END\n", CONFIG_BLOCK_TIMEOUT_MS);
+        CONFIG_Begin(false);
+    }
+    return batch.block;
+}
+
+HAL_StatusTypeDef CONFIG_Apply(char* buffer) {
+    batch.block = false;
+
+    if (batch.profile >= 0 && PROFILE_Select(batch.profile, true) != HAL_OK) {
+        CONFIG_Error("PROFILE", "outputs");
+    }
+    for (int i = 0; i < PROFILE_PORT_COUNT; i++) {
+        if (batch.baud[i] && PROFILE_SetBaud(i, batch.baud[i]) != HAL_OK) {
+            CONFIG_Error(config_bauds[i].key, "value");
+        }
+    }
+    if (batch.pin_count && GPIO_WritePins(batch.pins, batch.pin_count) != HAL_OK) {
+        CONFIG_Error("outputs", "write");
+    }
+    if (batch.serial_cfg >= 0) {
+        serialCFG = batch.serial_cfg;
+        setSerialCFG();
+    }
+
+    if (batch.errors == 0) {
+        sprintf(buffer, "OK %u", batch.keys);
+        return HAL_OK;
+    }
+    sprintf(buffer, "ERROR %u/%u%s", batch.keys > batch.errors ? batch.keys - batch.errors : 0,
+            batch.keys, batch.error_text);
+    return HAL_ERROR;
+}
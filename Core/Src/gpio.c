@@ -26,152 +26,186 @@ extern uint8_t serialCFG;
 // Initialize I2C2 as master for the PCA9534
 PCA9534_HandleTypeDef hPCA;
 
-// Static configurations for all GPIO pins including PCA9534
-static const GPIO_PinConfig mcu_gpio_configs[] = {
-    // GPIOA outputs
+// Input change events, filled by the EXTI handlers
+static GPIO_InputEvent event_buffer[GPIO_EVENT_BUFFER_SIZE];
+static volatile uint16_t event_head = 0;
+static volatile uint16_t event_tail = 0;
+static volatile uint32_t event_overflows = 0;
+static bool event_push = false;
+
+// Pin table index that owns each EXTI line, -1 when unused.
+// Lines are shared across ports (PB13/PC13 both map to EXTI13).
+static volatile int8_t exti_owner[16] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+// Per-line edge callback set by GPIO_SetEdgeHook(), replaces event logging
+static GPIO_EdgeHook volatile exti_hook[16];
+
+// Unified pin table: MCU outputs, PCA9534 outputs, then MCU inputs.
+// Names must be unique (case-insensitive). After adding, removing or renaming
+// an entry, run gen_pin_hash.py to regenerate gpio_name_slots[] below.
+static const GPIO_PinConfig gpio_pins[] = {
+    // GPIOA/B/C outputs
     {
         .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_OUTPUT,
         .GPIOx = GPIOA,
         .GPIO_Pin = GPIO_PIN_5,
         .name = "SER1_RS232_EN"
     },
     {
         .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_OUTPUT,
         .GPIOx = GPIOC,
         .GPIO_Pin = GPIO_PIN_12,
         .name = "SER2_RS232_EN"
     },
     {
         .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_OUTPUT,
         .GPIOx = GPIOC,
         .GPIO_Pin = GPIO_PIN_0,
         .name = "RS232_5_OEN"
     },
     {
         .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_OUTPUT,
         .GPIOx = GPIOC,
         .GPIO_Pin = GPIO_PIN_6,
         .name = "RS232_5_RTS"
     },
     {
         .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_OUTPUT,
         .GPIOx = GPIOC,
         .GPIO_Pin = GPIO_PIN_7,
         .name = "RS485_4_DE"
     },
     {
         .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_OUTPUT,
         .GPIOx = GPIOC,
         .GPIO_Pin = GPIO_PIN_8,
         .name = "RS485_4_REN"
     },
     {
         .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_OUTPUT,
         .GPIOx = GPIOA,
         .GPIO_Pin = GPIO_PIN_8,
-        .name = "J7_RST"
+        .name = "J7_RST",
+        .activeState = GPIO_PIN_SET    // Reset asserted while high (used by BOOTTIME)
     },
     {
         .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_OUTPUT,
         .GPIOx = GPIOA,
         .GPIO_Pin = GPIO_PIN_10,
-        .name = "COM2_RSTn"
+        .name = "COM2_RSTn",
+        .activeState = GPIO_PIN_RESET  // Reset asserted while low
     },
     {
         .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_OUTPUT,
         .GPIOx = GPIOA,
         .GPIO_Pin = GPIO_PIN_12,
         .name = "5V_VMAIN_PG"
     },
-	{
+    {
         .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_OUTPUT,
         .GPIOx = GPIOA,
         .GPIO_Pin = GPIO_PIN_15,
         .name = "P105"
     },
-    // GPIOB outputs
     {
         .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_OUTPUT,
         .GPIOx = GPIOB,
         .GPIO_Pin = GPIO_PIN_1,
         .name = "LED1"
     },
     {
         .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_OUTPUT,
         .GPIOx = GPIOB,
         .GPIO_Pin = GPIO_PIN_5,
         .name = "LED2"
     },
-    // Terminator
-    {
-        .type = GPIO_TYPE_MCU,
-        .GPIOx = NULL,
-        .GPIO_Pin = 0,
-        .name = {0}
-    }
-};
 
-static const GPIO_PinConfig pca_gpio_configs[] = {
+    // PCA9534 pins. .dir is the boot direction, PCA_DIR changes it at run time
+    // (the expander's config register is the live copy, see GPIO_IsInput)
     {
         .type = GPIO_TYPE_PCA9534,
+        .dir = GPIO_DIR_OUTPUT,
         .PCA9534_Pin = BLON,
+        .activeState = GPIO_PIN_SET,
         .name = "BLON"
     },
     {
         .type = GPIO_TYPE_PCA9534,
+        .dir = GPIO_DIR_OUTPUT,
         .PCA9534_Pin = BRITE,
+        .activeState = GPIO_PIN_SET,
         .name = "BRITE"
     },
     {
         .type = GPIO_TYPE_PCA9534,
+        .dir = GPIO_DIR_OUTPUT,
         .PCA9534_Pin = ERG_PWM,
+        .activeState = GPIO_PIN_SET,
         .name = "ERG_PWM"
     },
     {
         .type = GPIO_TYPE_PCA9534,
+        .dir = GPIO_DIR_OUTPUT,
         .PCA9534_Pin = PWM_EXT,
+        .activeState = GPIO_PIN_SET,
         .name = "PWM_EXT"
     },
     {
         .type = GPIO_TYPE_PCA9534,
+        .dir = GPIO_DIR_OUTPUT,
         .PCA9534_Pin = Vin_Vinv_EN,
+        .activeState = GPIO_PIN_SET,
         .name = "VIN_INV_EN"
     },
     {
         .type = GPIO_TYPE_PCA9534,
+        .dir = GPIO_DIR_OUTPUT,
         .PCA9534_Pin = Vin_Main_EN,
+        .activeState = GPIO_PIN_SET,
         .name = "VIN_MAIN_EN"
     },
     {
         .type = GPIO_TYPE_PCA9534,
+        .dir = GPIO_DIR_OUTPUT,
         .PCA9534_Pin = V5_Vinv_EN,
+        .activeState = GPIO_PIN_SET,
         .name = "V5_INV_EN"
     },
     {
         .type = GPIO_TYPE_PCA9534,
+        .dir = GPIO_DIR_OUTPUT,
         .PCA9534_Pin = V5_VMain_EN,
+        .activeState = GPIO_PIN_SET,
         .name = "V5_MAIN_EN"
     },
-    // Terminator
-    {
-        .type = GPIO_TYPE_PCA9534,
-        .PCA9534_Pin = 0,
-        .name = {0}
-    }
-};
-
 
-// Static configurations for all input GPIO pins
-static const GPIO_InputConfig mcu_input_configs[] = {
     // Power monitoring inputs
-	{
-		.GPIOx = GPIOA,
-		.GPIO_Pin = VIN_VINV_PG_PIN,
-		.name = "VIN_VINV_PG",
-		.description = "Inverter input power good",
-		.activeState = GPIO_PIN_SET    // Active high - high means power is good
-	},
     {
+        .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_INPUT,
+        .GPIOx = GPIOA,
+        .GPIO_Pin = VIN_VINV_PG_PIN,
+        .name = "VIN_VINV_PG",
+        .description = "Inverter input power good",
+        .activeState = GPIO_PIN_SET    // Active high - high means power is good
+    },
+    {
+        .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_INPUT,
         .GPIOx = GPIOB,
         .GPIO_Pin = VIN_VMAIN_PG_PIN,
         .name = "VIN_VMAIN_PG",
@@ -179,6 +213,8 @@ static const GPIO_InputConfig mcu_input_configs[] = {
         .activeState = GPIO_PIN_SET
     },
     {
+        .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_INPUT,
         .GPIOx = GPIOB,
         .GPIO_Pin = V5_VINV_PG_PIN,
         .name = "V5_VINV_PG",
@@ -186,6 +222,8 @@ static const GPIO_InputConfig mcu_input_configs[] = {
         .activeState = GPIO_PIN_SET
     },
     {
+        .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_INPUT,
         .GPIOx = GPIOA,
         .GPIO_Pin = V5_VMAIN_PG_PIN,
         .name = "V5_VMAIN_PG",
@@ -195,6 +233,8 @@ static const GPIO_InputConfig mcu_input_configs[] = {
 
     // Current monitoring inputs
     {
+        .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_INPUT,
         .GPIOx = GPIOA,
         .GPIO_Pin = VIN_VINV_IMON_PIN,
         .name = "VIN_VINV_IMON",
@@ -202,6 +242,8 @@ static const GPIO_InputConfig mcu_input_configs[] = {
         .activeState = GPIO_PIN_SET
     },
     {
+        .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_INPUT,
         .GPIOx = GPIOA,
         .GPIO_Pin = VIN_VMAIN_IMON_PIN,
         .name = "VIN_VMAIN_IMON",
@@ -209,13 +251,17 @@ static const GPIO_InputConfig mcu_input_configs[] = {
         .activeState = GPIO_PIN_SET
     },
     {
+        .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_INPUT,
         .GPIOx = GPIOA,
         .GPIO_Pin = V5_VINV_IMON_PIN,
         .name = "V5_VINV_IMON",
         .description = "5V inverter current monitor",
-   	    .activeState = GPIO_PIN_SET
+        .activeState = GPIO_PIN_SET
     },
     {
+        .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_INPUT,
         .GPIOx = GPIOC,
         .GPIO_Pin = V5_VMAIN_IMON_PIN,
         .name = "V5_VMAIN_IMON",
@@ -225,45 +271,96 @@ static const GPIO_InputConfig mcu_input_configs[] = {
 
     // Serial status inputs
     {
+        .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_INPUT,
         .GPIOx = GPIOC,
         .GPIO_Pin = SER1_INVALIDn_PIN,
         .name = "SER1_INVALIDn",
         .description = "Serial port 1 invalid status (active low)",
-   		.activeState = GPIO_PIN_RESET
+        .activeState = GPIO_PIN_RESET
     },
     {
+        .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_INPUT,
         .GPIOx = GPIOC,
         .GPIO_Pin = SER2_INVALIDn_PIN,
         .name = "SER2_INVALIDn",
         .description = "Serial port 2 invalid status (active low)",
-   		.activeState = GPIO_PIN_RESET
+        .activeState = GPIO_PIN_RESET
     },
 
     // Other inputs
     {
+        .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_INPUT,
         .GPIOx = GPIOB,
         .GPIO_Pin = I2C_GPIO_INTn_PIN,
         .name = "I2C_GPIO_INTn",
         .description = "I2C GPIO interrupt (active low)",
-   	    .activeState = GPIO_PIN_RESET
+        .activeState = GPIO_PIN_RESET
     },
     {
+        .type = GPIO_TYPE_MCU,
+        .dir = GPIO_DIR_INPUT,
         .GPIOx = GPIOD,
         .GPIO_Pin = P104_PIN,
         .name = "P104",
         .description = "General purpose input pin",
         .activeState = GPIO_PIN_SET
-    },
-
-    // Terminator
-    {
-        .GPIOx = NULL,
-        .GPIO_Pin = 0,
-        .name = {0},
-        .description = {0}
     }
 };
 
+#define GPIO_PIN_COUNT  ((int)(sizeof(gpio_pins) / sizeof(gpio_pins[0])))
+
+/* BEGIN GENERATED PIN HASH */
+#define GPIO_NAME_HASH_BITS  6
+#define GPIO_NAME_HASH_SEED  2166328921U
+
+// Hash slot -> gpio_pins[] index, -1 for an empty slot
+static const int8_t gpio_name_slots[1 << GPIO_NAME_HASH_BITS] = {
+    -1, -1, -1,  0, 15, 17, 13,  8, 19, 18,  5,  1, -1, -1, -1, 21,
+    -1, 12, -1, -1, 23, -1, 20, -1, -1, 24, 27, 26, -1, -1, -1, 29,
+    -1, -1,  6, 16, -1,  2, -1, -1, -1, 28, -1, -1, -1,  7, -1, 30,
+    -1, -1, -1, 25, 22, 31,  9,  3, -1, 11, 10, -1,  4, 14, -1, -1
+};
+/* END GENERATED PIN HASH */
+
+_Static_assert(GPIO_PIN_COUNT <= (1 << GPIO_NAME_HASH_BITS), "gpio_name_slots[] too small, rerun gen_pin_hash.py");
+_Static_assert(GPIO_PIN_COUNT <= 32 * GPIO_STATE_WORDS, "GPIO_STATE_WORDS too small for the pin table");
+
+// Debounce state, indexed like gpio_pins[] (only inputs are used)
+static GPIO_DebounceState debounce[GPIO_PIN_COUNT];
+
+
+
+/* MCU pin directions are fixed by the table, PCA9534 ones live in its config register */
+static bool GPIO_IsInput(const GPIO_PinConfig* config) {
+    if (config->type == GPIO_TYPE_PCA9534) {
+        return (hPCA.ConfigShadow & config->PCA9534_Pin) != 0;
+    }
+    return config->dir == GPIO_DIR_INPUT;
+}
+
+/**
+ * @brief Refresh the PCA9534 input cache before a scan
+ *
+ * With INTn tracking the cache is already current unless INTn fired, so this
+ * only goes on the bus when an input changed.
+ */
+static void GPIO_PCARefresh(void) {
+    uint8_t input;
+    PCA9534_GetInput(&hPCA, &input, !hPCA.IntTracking);
+}
+
+/* Live level of an input: IDR for MCU pins, the input cache for PCA9534 pins */
+static GPIO_PinState GPIO_ReadInputLevel(const GPIO_InputConfig* config) {
+    if (config->type == GPIO_TYPE_PCA9534) {
+        uint8_t input = 0;
+        PCA9534_GetInput(&hPCA, &input, !hPCA.IntTracking);
+        return (input & config->PCA9534_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+    }
+    return HAL_GPIO_ReadPin(config->GPIOx, config->GPIO_Pin);
+}
 
 /**
  * @brief Check if an input pin is in its active state
@@ -277,28 +374,58 @@ bool GPIO_IsInputActive(const char* name) {
         return false;
     }
 
-    GPIO_PinState state = HAL_GPIO_ReadPin(config->GPIOx, config->GPIO_Pin);
+    GPIO_PinState state;
+    const GPIO_DebounceState* db = &debounce[config - gpio_pins];
+    if (db->debounce_us == 0) {
+        state = GPIO_ReadInputLevel(config);
+    } else {
+        state = db->stable ? GPIO_PIN_SET : GPIO_PIN_RESET;
+    }
 
     // Return true if the current state matches the active state
     return (state == config->activeState);
 }
 
 /**
- * @brief Find input pin configuration by name
- * @param name: Name of the input pin to find
- * @return Pointer to GPIO_InputConfig structure or NULL if not found
+ * @brief Hash a pin name for gpio_name_slots[]
+ * @param name: Pin name (any case)
+ * @return Slot index
+ *
+ * FNV-1a over the upper-cased characters; must match gen_pin_hash.py.
  */
-const GPIO_InputConfig* GPIO_FindInputByName(const char* name) {
+static uint32_t GPIO_NameHash(const char* name) {
+    uint32_t h = GPIO_NAME_HASH_SEED;
+    while (*name) {
+        uint8_t c = (uint8_t)*name++;
+        if (c >= 'a' && c <= 'z') c -= 32;
+        h = (h ^ c) * 16777619U;
+    }
+    return h >> (32 - GPIO_NAME_HASH_BITS);
+}
+
+/**
+ * @brief Find any pin (input or output) by exact, case-insensitive name
+ * @param name: Name of the pin to find
+ * @return Pointer to GPIO_PinConfig structure or NULL if not found
+ */
+static const GPIO_PinConfig* GPIO_FindPin(const char* name) {
     if (name == NULL) return NULL;
 
-    // Check input configs
-    for (int i = 0; mcu_input_configs[i].name[0] != 0; i++) {
-        if (strncasecmp(name, mcu_input_configs[i].name, strlen(mcu_input_configs[i].name)) == 0) {
-            return &mcu_input_configs[i];
-        }
+    int idx = gpio_name_slots[GPIO_NameHash(name)];
+    if (idx < 0 || strcasecmp(name, gpio_pins[idx].name) != 0) {
+        return NULL;
     }
+    return &gpio_pins[idx];
+}
 
-    return NULL;
+/**
+ * @brief Find input pin configuration by name
+ * @param name: Name of the input pin to find
+ * @return Pointer to GPIO_InputConfig structure or NULL if not found
+ */
+const GPIO_InputConfig* GPIO_FindInputByName(const char* name) {
+    const GPIO_PinConfig* config = GPIO_FindPin(name);
+    return (config != NULL && GPIO_IsInput(config)) ? config : NULL;
 }
 
 /**
@@ -313,7 +440,7 @@ int GPIO_ReadInputByName(const char* name) {
         return -1;
     }
 
-    return HAL_GPIO_ReadPin(config->GPIOx, config->GPIO_Pin);
+    return GPIO_ReadInputLevel(config);
 }
 
 /**
@@ -329,8 +456,9 @@ HAL_StatusTypeDef GPIO_PrintInputByName(char *buffer, const char* name) {
         return HAL_ERROR;
     }
 
-    GPIO_PinState state = HAL_GPIO_ReadPin(config->GPIOx, config->GPIO_Pin);
-    sprintf(tStr, "%-15s : %s (%s)\n", config->name, state == GPIO_PIN_SET ? "HIGH" : "LOW", config->description);
+    GPIO_PinState state = GPIO_ReadInputLevel(config);
+    sprintf(tStr, "%-15s : %s (%s)\n", config->name, state == GPIO_PIN_SET ? "HIGH" : "LOW",
+            config->description ? config->description : "PCA9534 input");
     //printf(">>>%s\n\r", tStr);
     strcat(buffer, tStr);
     return HAL_OK;
@@ -344,8 +472,10 @@ void GPIO_PrintInputStates(char *buffer) {
     strcat(buffer, "------------------------------\n");
 
     // Print input states
-    for (int i = 0; mcu_input_configs[i].name[0] != 0; i++) {
-        GPIO_PrintInputByName(buffer, mcu_input_configs[i].name);
+    GPIO_PCARefresh();
+    for (int i = 0; i < GPIO_PIN_COUNT; i++) {
+        if (!GPIO_IsInput(&gpio_pins[i])) continue;
+        GPIO_PrintInputByName(buffer, gpio_pins[i].name);
     }
     strcat(buffer, "\n");
 }
@@ -378,6 +508,227 @@ HAL_StatusTypeDef GPIO_SetPin(const GPIO_PinConfig* config, GPIO_PinState state)
     }
 }
 
+// PG_TIME in progress, finished by GPIO_ProcessResponse()
+static struct {
+    bool running;
+    const GPIO_InputConfig* in;
+    uint32_t target;            // IDR bit value that ends the wait
+    uint32_t start_us;          // micros() when the output changed
+    uint32_t timeout_us;
+} pg_wait;
+
+/* Reply "<input> <us>" */
+static void GPIO_ResponseReply(const GPIO_InputConfig* in, uint32_t delay_us) {
+    char msg[48];
+
+    sprintf(msg, "%s %lu", in->name, (unsigned long)delay_us);
+    sendReply("PG_TIME", msg);
+}
+
+/**
+ * @brief Drive an output and time how long an input takes to follow
+ * @param out: Output to drive (MCU or PCA9534)
+ * @param level: Level to drive the output to
+ * @param in: MCU input to watch
+ * @param active: true to wait for the input to become active, false for inactive
+ * @param timeout_us: Give up after this long
+ * @return HAL_OK if answered or queued, HAL_BUSY if a PG_TIME is running,
+ *         HAL_ERROR on a bad pin or a failed write
+ *
+ * Replies {"PG_TIME" : "<input> <us>"}, "ALREADY" if the input was there
+ * before the write, or "TIMEOUT". The input's IDR bit is polled for the
+ * first PG_TIME_SPIN_MS, which times a fast rail to a few us whether or
+ * not its line is armed. A slower one is left to GPIO_ProcessResponse(),
+ * which takes the edge from the input's last-edge timestamp (exact with
+ * EVENT_ARM, 1 ms otherwise) so the main loop keeps running. For a
+ * PCA9534 output the start is taken when the I2C write returns, just
+ * after the expander latched it.
+ */
+HAL_StatusTypeDef GPIO_StartResponse(const GPIO_PinConfig* out, GPIO_PinState level,
+                                     const GPIO_InputConfig* in, bool active, uint32_t timeout_us) {
+    if (pg_wait.running) {
+        return HAL_BUSY;
+    }
+    if (out == NULL || in == NULL ||
+        out->dir != GPIO_DIR_OUTPUT || in->dir != GPIO_DIR_INPUT || in->type != GPIO_TYPE_MCU) {
+        return HAL_ERROR;
+    }
+
+    uint32_t target = (active == (in->activeState == GPIO_PIN_SET)) ? in->GPIO_Pin : 0;
+    if ((in->GPIOx->IDR & in->GPIO_Pin) == target) {
+        sendReply("PG_TIME", "ALREADY");
+        return HAL_OK;
+    }
+
+    if (GPIO_SetPin(out, level) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    uint32_t start = micros();
+    uint32_t spin_us = (timeout_us < PG_TIME_SPIN_MS * 1000U) ? timeout_us : PG_TIME_SPIN_MS * 1000U;
+    while ((in->GPIOx->IDR & in->GPIO_Pin) != target) {
+        if (micros() - start > spin_us) {
+            pg_wait.in = in;
+            pg_wait.target = target;
+            pg_wait.start_us = start;
+            pg_wait.timeout_us = timeout_us;
+            pg_wait.running = true;
+            GPIO_ProcessResponse();
+            return HAL_OK;
+        }
+    }
+    GPIO_ResponseReply(in, micros() - start);
+    return HAL_OK;
+}
+
+/**
+ * @brief Answer a PG_TIME that outlasted the spin, called from the main loop
+ */
+void GPIO_ProcessResponse(void) {
+    uint8_t raw;
+    uint32_t when;
+
+    if (!pg_wait.running) {
+        return;
+    }
+    GPIO_GetLastEdge(pg_wait.in, &raw, &when);
+    if (raw == (pg_wait.target != 0) && (int32_t)(when - pg_wait.start_us) >= 0) {
+        pg_wait.running = false;
+        GPIO_ResponseReply(pg_wait.in, when - pg_wait.start_us);
+    } else if (micros() - pg_wait.start_us > pg_wait.timeout_us) {
+        pg_wait.running = false;
+        sendReply("PG_TIME", "TIMEOUT");
+    }
+}
+
+/**
+ * @brief Apply several pin updates at once
+ * @param writes: Array of pin/state pairs
+ * @param count: Number of entries in writes
+ * @return HAL_StatusTypeDef
+ *
+ * All MCU pins on the same port change together with a single BSRR write,
+ * and all PCA9534 pins change together with a single output register write.
+ * If a pin appears more than once, the last entry wins.
+ */
+HAL_StatusTypeDef GPIO_WritePins(const GPIO_PinWrite* writes, int count) {
+    static GPIO_TypeDef* const ports[] = { GPIOA, GPIOB, GPIOC, GPIOD, GPIOF };
+    uint32_t set_mask[sizeof(ports) / sizeof(ports[0])] = {0};
+    uint32_t reset_mask[sizeof(ports) / sizeof(ports[0])] = {0};
+    uint8_t pca_output = hPCA.OutputRequest;
+    bool pca_changed = false;
+
+    if (writes == NULL || count <= 0) {
+        return HAL_ERROR;
+    }
+
+    // Collect the masks first so nothing changes if an entry is invalid
+    for (int i = 0; i < count; i++) {
+        const GPIO_PinConfig* config = writes[i].config;
+        if (config == NULL) {
+            return HAL_ERROR;
+        }
+
+        if (config->type == GPIO_TYPE_MCU) {
+            int p;
+            for (p = 0; p < (int)(sizeof(ports) / sizeof(ports[0])); p++) {
+                if (ports[p] == config->GPIOx) break;
+            }
+            if (p == (int)(sizeof(ports) / sizeof(ports[0]))) {
+                return HAL_ERROR;
+            }
+            if (writes[i].state == GPIO_PIN_SET) {
+                set_mask[p] |= config->GPIO_Pin;
+                reset_mask[p] &= ~config->GPIO_Pin;
+            } else {
+                reset_mask[p] |= config->GPIO_Pin;
+                set_mask[p] &= ~config->GPIO_Pin;
+            }
+        } else if (config->type == GPIO_TYPE_PCA9534) {
+            if (writes[i].state == GPIO_PIN_SET) {
+                pca_output |= config->PCA9534_Pin;
+            } else {
+                pca_output &= ~config->PCA9534_Pin;
+            }
+            pca_changed = true;
+        } else {
+            return HAL_ERROR;
+        }
+    }
+
+    // BSRR: low half sets, high half resets, applied in one bus cycle
+    for (int p = 0; p < (int)(sizeof(ports) / sizeof(ports[0])); p++) {
+        if (set_mask[p] | reset_mask[p]) {
+            ports[p]->BSRR = set_mask[p] | (reset_mask[p] << 16);
+        }
+    }
+
+    if (pca_changed) {
+        if (PCA9534_WriteOutput(&hPCA, pca_output) != PCA9534_OK) {
+            return HAL_ERROR;
+        }
+    }
+
+    return HAL_OK;
+}
+
+/**
+ * @brief Snapshot the output pins for the saved configuration, bit i is gpio_pins[i]
+ * @param outputs: Set for pins that are outputs now (GPIO_STATE_WORDS words)
+ * @param levels: Set for outputs driven high, from ODR and the PCA9534 output shadow
+ * @return Pin table size, so a snapshot from another table can be rejected
+ */
+int GPIO_GetOutputStates(uint32_t* outputs, uint32_t* levels) {
+    memset(outputs, 0, GPIO_STATE_WORDS * sizeof(uint32_t));
+    memset(levels, 0, GPIO_STATE_WORDS * sizeof(uint32_t));
+
+    for (int i = 0; i < GPIO_PIN_COUNT; i++) {
+        const GPIO_PinConfig* config = &gpio_pins[i];
+        bool high;
+
+        if (GPIO_IsInput(config) || (config->type == GPIO_TYPE_MCU && config->GPIOx == NULL)) continue;
+        if (config->type == GPIO_TYPE_MCU) {
+            high = (config->GPIOx->ODR & config->GPIO_Pin) != 0;
+        } else {
+            high = (hPCA.OutputShadow & config->PCA9534_Pin) != 0;
+        }
+        outputs[i / 32] |= 1UL << (i % 32);
+        if (high) levels[i / 32] |= 1UL << (i % 32);
+    }
+    return GPIO_PIN_COUNT;
+}
+
+/**
+ * @brief Drive the outputs of a GPIO_GetOutputStates() snapshot
+ *
+ * Pins that are inputs now are skipped. All pins change in one
+ * GPIO_WritePins() batch per GPIO_WRITE_MAX_PINS pins.
+ * @return HAL_OK, or HAL_ERROR if the snapshot is from another pin table or a write failed
+ */
+HAL_StatusTypeDef GPIO_SetOutputStates(int pin_count, const uint32_t* outputs, const uint32_t* levels) {
+    GPIO_PinWrite writes[GPIO_WRITE_MAX_PINS];
+    HAL_StatusTypeDef status = HAL_OK;
+    int count = 0;
+
+    if (pin_count != GPIO_PIN_COUNT) {
+        return HAL_ERROR;
+    }
+    for (int i = 0; i < GPIO_PIN_COUNT; i++) {
+        if (!(outputs[i / 32] & (1UL << (i % 32))) || GPIO_IsInput(&gpio_pins[i])) continue;
+
+        writes[count].config = &gpio_pins[i];
+        writes[count].state = (levels[i / 32] & (1UL << (i % 32))) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+        if (++count == GPIO_WRITE_MAX_PINS) {
+            if (GPIO_WritePins(writes, count) != HAL_OK) status = HAL_ERROR;
+            count = 0;
+        }
+    }
+    if (count && GPIO_WritePins(writes, count) != HAL_OK) {
+        status = HAL_ERROR;
+    }
+    return status;
+}
+
 /**
  * @brief Read the state of any GPIO pin (MCU or PCA9534)
  * @param config: Pointer to GPIO_PinConfig structure
@@ -399,7 +750,8 @@ HAL_StatusTypeDef GPIO_GetPin(const GPIO_PinConfig* config, GPIO_PinState* state
 
         case GPIO_TYPE_PCA9534: {
             uint8_t currentInput;
-            if (PCA9534_ReadInput(&hPCA, &currentInput) != PCA9534_OK) {
+            // Served from the input cache; callers refresh it once per scan
+            if (PCA9534_GetInput(&hPCA, &currentInput, false) != PCA9534_OK) {
                 return HAL_ERROR;
             }
             *state = (currentInput & config->PCA9534_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
@@ -430,28 +782,30 @@ void GPIO_PrintDetailedInfo(char *buffer) {
     strcat(buffer, tStr);
     strcat(buffer, "--------------------------------------------\n");
 
-    for (int i = 0; mcu_gpio_configs[i].name[0] != 0; i++) {
+    for (int i = 0; i < GPIO_PIN_COUNT; i++) {
+        if (gpio_pins[i].type != GPIO_TYPE_MCU || gpio_pins[i].dir != GPIO_DIR_OUTPUT) continue;
+
         // Get port letter
-        if (mcu_gpio_configs[i].GPIOx == GPIOA) strcpy(port_name, "GPIOA");
-        else if (mcu_gpio_configs[i].GPIOx == GPIOB) strcpy(port_name, "GPIOB");
-        else if (mcu_gpio_configs[i].GPIOx == GPIOC) strcpy(port_name, "GPIOC");
-        else if (mcu_gpio_configs[i].GPIOx == GPIOD) strcpy(port_name, "GPIOD");
-        else if (mcu_gpio_configs[i].GPIOx == GPIOF) strcpy(port_name, "GPIOF");
+        if (gpio_pins[i].GPIOx == GPIOA) strcpy(port_name, "GPIOA");
+        else if (gpio_pins[i].GPIOx == GPIOB) strcpy(port_name, "GPIOB");
+        else if (gpio_pins[i].GPIOx == GPIOC) strcpy(port_name, "GPIOC");
+        else if (gpio_pins[i].GPIOx == GPIOD) strcpy(port_name, "GPIOD");
+        else if (gpio_pins[i].GPIOx == GPIOF) strcpy(port_name, "GPIOF");
         else strcpy(port_name, "???");
 
         // Get pin number from pin mask
         pin_number = 0;
-        uint32_t pin_mask = mcu_gpio_configs[i].GPIO_Pin;
+        uint32_t pin_mask = gpio_pins[i].GPIO_Pin;
         while (pin_mask > 1) {
             pin_mask = pin_mask >> 1;
             pin_number++;
         }
 
         // Get current state
-        GPIO_GetPin(&mcu_gpio_configs[i], &state);
+        GPIO_GetPin(&gpio_pins[i], &state);
 
         sprintf(tStr, "%-15s | %-5s | PIN_%-6d | %s\n",
-               mcu_gpio_configs[i].name,
+               gpio_pins[i].name,
                port_name,
                pin_number,
                state == GPIO_PIN_SET ? "HIGH" : "LOW");
@@ -459,27 +813,31 @@ void GPIO_PrintDetailedInfo(char *buffer) {
     }
 
     // Print PCA9534 Outputs
-    strcat(buffer, "\nPCA9534 OUTPUTS:\n");
-    sprintf(tStr, "%-15s | %-10s  | %-5s\n", "NAME", "PIN", "STATE");
+    GPIO_PCARefresh();  // At most one bus read for all PCA pins
+    strcat(buffer, "\nPCA9534 PINS:\n");
+    sprintf(tStr, "%-15s | %-10s  | %-5s | %s\n", "NAME", "PIN", "STATE", "DIR");
     strcat(buffer, tStr);
     strcat(buffer, "-------------------------------------\n");
 
-    for (int i = 0; pca_gpio_configs[i].name[0] != 0; i++) {
+    for (int i = 0; i < GPIO_PIN_COUNT; i++) {
+        if (gpio_pins[i].type != GPIO_TYPE_PCA9534) continue;
+
         // Get pin number as a bit position (0-7)
         pin_number = 0;
-        uint8_t pin_mask = pca_gpio_configs[i].PCA9534_Pin;
+        uint8_t pin_mask = gpio_pins[i].PCA9534_Pin;
         while (pin_mask > 1) {
             pin_mask = pin_mask >> 1;
             pin_number++;
         }
 
         // Get current state
-        GPIO_GetPin(&pca_gpio_configs[i], &state);
+        GPIO_GetPin(&gpio_pins[i], &state);
 
-        sprintf(tStr, "%-15s | I2C_PIN_%-3d | %s\n",
-               pca_gpio_configs[i].name,
+        sprintf(tStr, "%-15s | I2C_PIN_%-3d | %-5s | %s\n",
+               gpio_pins[i].name,
                pin_number,
-               state == GPIO_PIN_SET ? "HIGH" : "LOW");
+               state == GPIO_PIN_SET ? "HIGH" : "LOW",
+               GPIO_IsInput(&gpio_pins[i]) ? "IN" : "OUT");
         strcat(buffer, tStr);
     }
 
@@ -489,60 +847,47 @@ void GPIO_PrintDetailedInfo(char *buffer) {
     strcat(buffer, tStr);
     strcat(buffer, "-----------------------------------------------------------------------------------\n");
 
-    for (int i = 0; mcu_input_configs[i].name[0] != 0; i++) {
+    for (int i = 0; i < GPIO_PIN_COUNT; i++) {
+        if (gpio_pins[i].dir != GPIO_DIR_INPUT || gpio_pins[i].type != GPIO_TYPE_MCU) continue;
+
         // Get port letter
-        if (mcu_input_configs[i].GPIOx == GPIOA) strcpy(port_name, "GPIOA");
-        else if (mcu_input_configs[i].GPIOx == GPIOB) strcpy(port_name, "GPIOB");
-        else if (mcu_input_configs[i].GPIOx == GPIOC) strcpy(port_name, "GPIOC");
-        else if (mcu_input_configs[i].GPIOx == GPIOD) strcpy(port_name, "GPIOD");
-        else if (mcu_input_configs[i].GPIOx == GPIOF) strcpy(port_name, "GPIOF");
+        if (gpio_pins[i].GPIOx == GPIOA) strcpy(port_name, "GPIOA");
+        else if (gpio_pins[i].GPIOx == GPIOB) strcpy(port_name, "GPIOB");
+        else if (gpio_pins[i].GPIOx == GPIOC) strcpy(port_name, "GPIOC");
+        else if (gpio_pins[i].GPIOx == GPIOD) strcpy(port_name, "GPIOD");
+        else if (gpio_pins[i].GPIOx == GPIOF) strcpy(port_name, "GPIOF");
         else strcpy(port_name, "???");
 
         // Get pin number from pin mask
         pin_number = 0;
-        uint32_t pin_mask = mcu_input_configs[i].GPIO_Pin;
+        uint32_t pin_mask = gpio_pins[i].GPIO_Pin;
         while (pin_mask > 1) {
             pin_mask = pin_mask >> 1;
             pin_number++;
         }
 
         // Get current state
-        GPIO_PinState current_state = HAL_GPIO_ReadPin(mcu_input_configs[i].GPIOx, mcu_input_configs[i].GPIO_Pin);
+        GPIO_PinState current_state = HAL_GPIO_ReadPin(gpio_pins[i].GPIOx, gpio_pins[i].GPIO_Pin);
 
         // Check if pin is in active state
-        bool is_active = (current_state == mcu_input_configs[i].activeState);
+        bool is_active = (current_state == gpio_pins[i].activeState);
 
         sprintf(tStr, "%-15s | %-5s | PIN_%-6d | %s     | %s\n",
-               mcu_input_configs[i].name,
+               gpio_pins[i].name,
                port_name,
                pin_number,
                is_active ? "ACTIVE  " : "INACTIVE",
-               mcu_input_configs[i].description);
+               gpio_pins[i].description);
         strcat(buffer, tStr);
     }
 
     strcat(buffer, "\n===================================================================================\n");
 }
 
-// Helper function to find GPIO config by name
+// Helper function to find GPIO output config by name
 const GPIO_PinConfig* GPIO_FindByName(const char* name) {
-    if (name == NULL) return NULL;
-
-    // Check MCU GPIO configs
-    for (int i = 0; mcu_gpio_configs[i].name[0] != 0; i++) {
-        if (strncasecmp(name, mcu_gpio_configs[i].name, strlen(mcu_gpio_configs[i].name)) == 0) {
-            return &mcu_gpio_configs[i];
-        }
-    }
-
-    // Check PCA9534 configs
-    for (int i = 0; pca_gpio_configs[i].name[0] != 0; i++) {
-        if (strncasecmp(name, pca_gpio_configs[i].name, strlen(pca_gpio_configs[i].name)) == 0) {
-            return &pca_gpio_configs[i];
-        }
-    }
-
-    return NULL;
+    const GPIO_PinConfig* config = GPIO_FindPin(name);
+    return (config != NULL && !GPIO_IsInput(config)) ? config : NULL;
 }
 
 HAL_StatusTypeDef GPIO_SetOutputByName(const char* name, GPIO_PinState state) {
@@ -566,83 +911,112 @@ HAL_StatusTypeDef GPIO_ToggleByName(const char* name) {
         HAL_GPIO_TogglePin(config->GPIOx, config->GPIO_Pin);
         return HAL_OK;
     } else {
-        // For PCA9534, we need to read-modify-write
-        GPIO_PinState current_state;
-        if (GPIO_GetPin(config, &current_state) != HAL_OK) {
-            return HAL_ERROR;
-        }
-        return GPIO_SetPin(config, !current_state);
+        // For PCA9534, the output shadow makes this a single write
+        return (PCA9534_TogglePin(&hPCA, config->PCA9534_Pin) == PCA9534_OK) ?
+               HAL_OK : HAL_ERROR;
     }
 }
 
+// Transceiver control pins, all on GPIOC, and the level that turns each one off
+#define SERIAL_CFG_PORT     GPIOC
+#define SERIAL_OFF_SET      (RS232_5_OEN_PIN | RS485_4_REN_PIN)    // TTL off, RS-485 receiver off
+#define SERIAL_OFF_RESET    (SER2_RS232_EN_PIN | RS485_4_DE_PIN)   // RS-232 off, RS-485 driver off
+
+// Per-mode BSRR words built from the pins a mode turns on (on_set high,
+// on_reset low). "brk" turns off everything the mode does not use and is
+// written first; "make" then turns the mode's transceivers on. Pins the
+// old and new mode both enable are in neither write and never move.
+#define SERIAL_MODE(n, on_set, on_reset) { n, \
+    (SERIAL_OFF_SET & ~(uint32_t)(on_reset)) | ((SERIAL_OFF_RESET & ~(uint32_t)(on_set)) << 16), \
+    (uint32_t)(on_set) | ((uint32_t)(on_reset) << 16) }
+
+static const GPIO_SerialMode serial_modes[] = {
+    SERIAL_MODE("RS232", SER2_RS232_EN_PIN, 0),                    // serialCFG 0
+    SERIAL_MODE("RS485", SER2_RS232_EN_PIN, RS485_4_REN_PIN),      // serialCFG 1
+    SERIAL_MODE("TTL",   0, RS232_5_OEN_PIN),                      // serialCFG 2
+};
+
+static uint32_t serial_switch_ns;   // Break to make time of the last switch
+
+/**
+ * @brief Number of serialCFG modes, valid values are 0 to this minus one
+ */
+uint8_t GPIO_SerialModeCount(void) {
+	return sizeof(serial_modes) / sizeof(serial_modes[0]);
+}
+
+/**
+ * @brief Apply serialCFG to the transceiver control pins
+ *
+ * Two BSRR writes with interrupts masked, break then make, instead of a
+ * write per pin, so no pin passes through a level that neither mode uses.
+ * The time between the two writes is kept for GPIO_PrintSerialCFG().
+ * Invalid values fall back to RS-232.
+ */
 void setSerialCFG(void){
-	// UART CONFIGS
-	//RS232_5_OEN = PC0
-	//RS232_5_OEN = 0 enables TTL
-	//RS232_5_OEN = 1 disables TTL
-
-	//SER2_RS232_EN = PC12
-	//SER2_RS232_EN = 1 enables 232
-	//SER2_RS232_EN = 0 disables 232
-
-	//RS485_4_DE = PC7
-	//RS485_4_DE = 1 enables outputs
-	//RS485_4_DE = 0 disables outputs
-
-	//RS485_4_REN = PC8
-	//RS485_4_REN = 1 disables inputs
-	//RS485_4_REN = 0 enables inputs
-	switch (serialCFG) {
-	case 0: //232
-		//RS232_5_OEN = 1 disables TTL
-		GPIO_SetOutputByName("RS232_5_OEN", 1);
-		//SER2_RS232_EN = 1 enables 232
-		GPIO_SetOutputByName("SER2_RS232_EN", 1);
-		//RS485_4_DE = 0 disables outputs
-		GPIO_SetOutputByName("RS485_4_DE", 0);  //Disable RS-485 Receiver
-		//RS485_4_REN = 1 disables inputs
-		GPIO_SetOutputByName("RS485_4_REN", 1);  //Disable RS-485 Receiver
-		if(DEBUG_GPIO) printf("ENABLE 232\n");
-		break;
-
-	case 1: //485
-		//RS232_5_OEN = 1 disables TTL
-		GPIO_SetOutputByName("RS232_5_OEN", 1);
-		//SER2_RS232_EN = 1 enables 232
-		GPIO_SetOutputByName("SER2_RS232_EN", 1);
-		//RS485_4_DE = 0 disables outputs
-		GPIO_SetOutputByName("RS485_4_DE", 0);
-		//RS485_4_REN = 0 enables inputs
-		GPIO_SetOutputByName("RS485_4_REN", 0);
-		if(DEBUG_GPIO) printf("ENABLE 485\n");
-		break;
-
-	case 2: //TTL
-		//RS232_5_OEN = 0 enables TTL
-		GPIO_SetOutputByName("RS232_5_OEN", 0);
-		//SER2_RS232_EN = 0 disables 232
-		GPIO_SetOutputByName("SER2_RS232_EN", 0);
-		//RS485_4_DE = 0 disables outputs
-		GPIO_SetOutputByName("RS485_4_DE", 0);  //Disable RS-485 Receiver
-		//RS485_4_REN = 1 disables inputs
-		GPIO_SetOutputByName("RS485_4_REN", 1);  //Disable RS-485 Receiver
-		if(DEBUG_GPIO) printf("ENABLE TTL\n");
-		break;
-
-	default:
-		//RS232_5_OEN = 1 disables TTL
-		GPIO_SetOutputByName("RS232_5_OEN", 1);
-		//SER2_RS232_EN = 1 enables 232
-		GPIO_SetOutputByName("SER2_RS232_EN", 1);
-		//RS485_4_DE = 0 disables outputs
-		GPIO_SetOutputByName("RS485_4_DE", 0);  //Disable RS-485 Receiver
-		//RS485_4_REN = 1 disables inputs
-		GPIO_SetOutputByName("RS485_4_REN", 1);  //Disable RS-485 Receiver
+	const GPIO_SerialMode* mode = &serial_modes[0];
+
+	if (serialCFG < GPIO_SerialModeCount()) {
+		mode = &serial_modes[serialCFG];
+	} else {
 		sendDebug("SERCFG", "ERROR");
 		if(DEBUG_GPIO) printf("Invalid - setting to RS-232\n");
 	}
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint32_t start = SysTick->VAL;
+	SERIAL_CFG_PORT->BSRR = mode->brk;
+	SERIAL_CFG_PORT->BSRR = mode->make;
+	uint32_t end = SysTick->VAL;
+	__set_PRIMASK(primask);
+
+	// SysTick counts down from LOAD at the core clock
+	uint32_t cycles = (start >= end) ? start - end : start + SysTick->LOAD + 1 - end;
+	serial_switch_ns = cycles * 1000U / (SystemCoreClock / 1000000U);
+	if(DEBUG_GPIO) printf("ENABLE %s\n", mode->name);
+}
+
+void GPIO_PrintSerialCFG(char *buffer) {
+	const char* name = (serialCFG < GPIO_SerialModeCount()) ?
+	                   serial_modes[serialCFG].name : "INVALID";
+
+	sprintf(tStr, "%u %s switch_ns=%lu", serialCFG, name, (unsigned long)serial_switch_ns);
+	strcat(buffer, tStr);
+}
+
+
+/* INTn edge hook. Only the falling edge matters: INTn rises again when an input read clears it */
+static void GPIO_PCAIntEdge(uint8_t level, uint32_t now_us) {
+    (void)now_us;
+    if (level == 0) {
+        PCA9534_NotifyInt(&hPCA);
+    }
+}
+
+/**
+ * @brief Switch a PCA9534 pin between input and output
+ * @param name: Name of a PCA9534 pin
+ * @param input: true for input, false for output
+ * @return HAL_OK, or HAL_ERROR for an unknown or MCU pin or a failed write
+ */
+HAL_StatusTypeDef GPIO_SetPCADirection(const char* name, bool input) {
+    const GPIO_PinConfig* config = GPIO_FindPin(name);
+    if (config == NULL || config->type != GPIO_TYPE_PCA9534) {
+        return HAL_ERROR;
+    }
+    return (PCA9534_SetPinDirection(&hPCA, config->PCA9534_Pin, input) == PCA9534_OK) ? HAL_OK : HAL_ERROR;
 }
 
+/**
+ * @brief Print PCA9534 directions and input cache statistics
+ */
+void GPIO_PrintPCAStatus(char *buffer) {
+    sprintf(tStr, "config=0x%02X input=0x%02X int=%s int_count=%lu bus_reads=%lu",
+            hPCA.ConfigShadow, hPCA.InputCache, hPCA.IntTracking ? "ON" : "OFF",
+            (unsigned long)hPCA.IntCount, (unsigned long)hPCA.InputReads);
+    strcat(buffer, tStr);
+}
 
 /**
  * @brief Initialize GPIO including PCA9534 I/O expander
@@ -655,6 +1029,21 @@ void GPIO_Init(void) {
     // Initialize MCU GPIOs
     MX_GPIO_Init();
 
+    // Catch a pin table edit that was not followed by gen_pin_hash.py
+    for (int i = 0; i < GPIO_PIN_COUNT; i++) {
+        if (GPIO_FindPin(gpio_pins[i].name) != &gpio_pins[i]) {
+            if(DEBUG_GPIO) printf("Error: stale pin hash for %s\n", gpio_pins[i].name);
+        }
+    }
+
+    // Seed the debounce state with the current input levels
+    for (int i = 0; i < GPIO_PIN_COUNT; i++) {
+        if (gpio_pins[i].dir != GPIO_DIR_INPUT || gpio_pins[i].type != GPIO_TYPE_MCU) continue;
+        debounce[i].raw = (gpio_pins[i].GPIOx->IDR & gpio_pins[i].GPIO_Pin) ? 1 : 0;
+        debounce[i].stable = debounce[i].raw;
+        debounce[i].last_edge_us = micros();
+    }
+
     // Initialize PCA9534 on I2C2
     if(DEBUG_GPIO) printf("\nInitializing PCA9534...\n");
     if (PCA9534_Init(&hPCA, &hi2c2, PCA9534_I2C_ADDRESS) != PCA9534_OK) {
@@ -663,8 +1052,14 @@ void GPIO_Init(void) {
     }
 
     if (pca9534_ok) {
-        // Configure ALL PCA9534 pins as outputs (0 = output)
-        if (PCA9534_SetConfig(&hPCA, 0x00) != PCA9534_OK) {
+        // Boot directions from the pin table (1 = input)
+        uint8_t pca_config = 0x00;
+        for (int i = 0; i < GPIO_PIN_COUNT; i++) {
+            if (gpio_pins[i].type == GPIO_TYPE_PCA9534 && gpio_pins[i].dir == GPIO_DIR_INPUT) {
+                pca_config |= gpio_pins[i].PCA9534_Pin;
+            }
+        }
+        if (PCA9534_SetConfig(&hPCA, pca_config) != PCA9534_OK) {
             if(DEBUG_GPIO) printf("Error: PCA9534 Set Config FAILED\n");
             pca9534_ok = false;
         }
@@ -672,26 +1067,29 @@ void GPIO_Init(void) {
 
     if (pca9534_ok) {
         // Initialize PCA9534 pins with default states
-        for (int i = 0; pca_gpio_configs[i].name[0] != 0; i++) {
+        for (int i = 0; i < GPIO_PIN_COUNT; i++) {
+            if (gpio_pins[i].type != GPIO_TYPE_PCA9534 || GPIO_IsInput(&gpio_pins[i])) continue;
+
             uint8_t default_state = 0;
             // Set default states based on pin
-            if (pca_gpio_configs[i].PCA9534_Pin == BRITE ||
-                pca_gpio_configs[i].PCA9534_Pin == ERG_PWM ||
-                pca_gpio_configs[i].PCA9534_Pin == PWM_EXT ||
-                pca_gpio_configs[i].PCA9534_Pin == Vin_Vinv_EN) {
+            if (gpio_pins[i].PCA9534_Pin == BRITE ||
+                gpio_pins[i].PCA9534_Pin == ERG_PWM ||
+                gpio_pins[i].PCA9534_Pin == PWM_EXT ||
+                gpio_pins[i].PCA9534_Pin == Vin_Vinv_EN) {
                 default_state = 1;
             }
 
-            if (PCA9534_WritePin(&hPCA, pca_gpio_configs[i].PCA9534_Pin, default_state) != PCA9534_OK) {
-                if(DEBUG_GPIO) printf("Error: Failed to set %s\n", pca_gpio_configs[i].name);
+            if (PCA9534_WritePin(&hPCA, gpio_pins[i].PCA9534_Pin, default_state) != PCA9534_OK) {
+                if(DEBUG_GPIO) printf("Error: Failed to set %s\n", gpio_pins[i].name);
                 pca9534_ok = false;
             }
         }
     }
 
     // Initialize MCU GPIO outputs
-    for (int i = 0; mcu_gpio_configs[i].name[0] != 0; i++) {
-        GPIO_SetPin(&mcu_gpio_configs[i], GPIO_PIN_RESET);
+    for (int i = 0; i < GPIO_PIN_COUNT; i++) {
+        if (gpio_pins[i].type != GPIO_TYPE_MCU || gpio_pins[i].dir != GPIO_DIR_OUTPUT) continue;
+        GPIO_SetPin(&gpio_pins[i], GPIO_PIN_RESET);
     }
 
     setSerialCFG();
@@ -699,6 +1097,20 @@ void GPIO_Init(void) {
     GPIO_SetOutputByName("BLON", 1);
     GPIO_SetOutputByName("BRITE", 1);
 
+    // Power-good and transceiver status edges are logged from boot.
+    // VIN_VMAIN_PG (PB13) shares EXTI13 with SER2_INVALIDn and is left off.
+    GPIO_ArmInputEvent("VIN_VINV_PG");
+    GPIO_ArmInputEvent("V5_VINV_PG");
+    GPIO_ArmInputEvent("V5_VMAIN_PG");
+    GPIO_ArmInputEvent("SER1_INVALIDn");
+    GPIO_ArmInputEvent("SER2_INVALIDn");
+
+    // PCA9534 input changes pull INTn low; from here on the input cache is
+    // only re-read after that, not on every scan
+    if (pca9534_ok && GPIO_SetEdgeHook(GPIO_FindInputByName("I2C_GPIO_INTn"), GPIO_PCAIntEdge) == HAL_OK) {
+        hPCA.IntTracking = true;
+    }
+
     // Final status
     if(DEBUG_GPIO) printf("GPIO Init %s\n", pca9534_ok ? "OK" : "FAILED");
 }
@@ -708,13 +1120,15 @@ void GPIO_PrintStates(char *buffer) {
 	strcat(buffer, "------------------------------\n");
 
     // Print MCU GPIO states
-    for (int i = 0; mcu_gpio_configs[i].name[0] != 0; i++) {
+    for (int i = 0; i < GPIO_PIN_COUNT; i++) {
+        if (gpio_pins[i].type != GPIO_TYPE_MCU || gpio_pins[i].dir != GPIO_DIR_OUTPUT) continue;
+
         GPIO_PinState state;
-        if (GPIO_GetPin(&mcu_gpio_configs[i], &state) == HAL_OK) {
-        	sprintf(tStr, "%-15s : %s\n", mcu_gpio_configs[i].name, state == GPIO_PIN_SET ? "HIGH" : "LOW");
+        if (GPIO_GetPin(&gpio_pins[i], &state) == HAL_OK) {
+        	sprintf(tStr, "%-15s : %s\n", gpio_pins[i].name, state == GPIO_PIN_SET ? "HIGH" : "LOW");
             strcat(buffer, tStr);
         } else {
-        	sprintf(tStr, "%-15s : ERROR\n", mcu_gpio_configs[i].name);
+        	sprintf(tStr, "%-15s : ERROR\n", gpio_pins[i].name);
             strcat(buffer, tStr);
         }
     }
@@ -722,20 +1136,482 @@ void GPIO_PrintStates(char *buffer) {
     strcat(buffer, "\nPCA9534 GPIO States:\n");
     strcat(buffer, "------------------------------\n");
 
+    // Refresh the input cache once; the loop below reads from it
+    GPIO_PCARefresh();
+
     // Print PCA9534 GPIO states
-    for (int i = 0; pca_gpio_configs[i].name[0] != 0; i++) {
+    for (int i = 0; i < GPIO_PIN_COUNT; i++) {
+        if (gpio_pins[i].type != GPIO_TYPE_PCA9534) continue;
+
         GPIO_PinState state;
-        if (GPIO_GetPin(&pca_gpio_configs[i], &state) == HAL_OK) {
-        	sprintf(tStr, "%-15s : %s\n", pca_gpio_configs[i].name,
+        if (GPIO_GetPin(&gpio_pins[i], &state) == HAL_OK) {
+        	sprintf(tStr, "%-15s : %s\n", gpio_pins[i].name,
                    state == GPIO_PIN_SET ? "HIGH" : "LOW");
             strcat(buffer, tStr);
         } else {
-        	sprintf(tStr, "%-15s : ERROR\n", pca_gpio_configs[i].name);
+        	sprintf(tStr, "%-15s : ERROR\n", gpio_pins[i].name);
             strcat(buffer, tStr);
         }
     }
 }
 
+// ******************************************************************
+// Input change events (EXTI)
+// ******************************************************************
+
+// Bit position of a single-bit GPIO_PIN_x mask
+static int GPIO_PinNumber(uint16_t pin_mask) {
+    int pin_number = 0;
+    while (pin_mask > 1) {
+        pin_mask = pin_mask >> 1;
+        pin_number++;
+    }
+    return pin_number;
+}
+
+static IRQn_Type GPIO_ExtiIRQn(int line) {
+    if (line <= 1) return EXTI0_1_IRQn;
+    if (line <= 3) return EXTI2_3_IRQn;
+    return EXTI4_15_IRQn;
+}
+
+/**
+ * @brief Enable edge events on an MCU input
+ * @param name: Name of the input pin
+ * @return HAL_ERROR if unknown, not an MCU pin, or its EXTI line is taken
+ */
+HAL_StatusTypeDef GPIO_ArmInputEvent(const char* name) {
+    const GPIO_InputConfig* config = GPIO_FindInputByName(name);
+    if (config == NULL || config->type != GPIO_TYPE_MCU) {
+        return HAL_ERROR;
+    }
+
+    int line = GPIO_PinNumber(config->GPIO_Pin);
+    int index = config - gpio_pins;
+    if ((exti_owner[line] >= 0 && exti_owner[line] != index) || exti_hook[line] != NULL) {
+        if(DEBUG_GPIO) printf("Error: EXTI%d already used by %s\n", line, gpio_pins[exti_owner[line]].name);
+        return HAL_ERROR;
+    }
+
+    exti_owner[line] = index;
+
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+    GPIO_InitStruct.Pin = config->GPIO_Pin;
+    GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING_FALLING;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    HAL_GPIO_Init(config->GPIOx, &GPIO_InitStruct);
+
+    HAL_NVIC_SetPriority(GPIO_ExtiIRQn(line), 0, 0);
+    HAL_NVIC_EnableIRQ(GPIO_ExtiIRQn(line));
+    return HAL_OK;
+}
+
+/**
+ * @brief Stop edge events on an MCU input (the pin stays a plain input)
+ * @param name: Name of the input pin
+ * @return HAL_ERROR if unknown or not armed
+ */
+HAL_StatusTypeDef GPIO_DisarmInputEvent(const char* name) {
+    const GPIO_InputConfig* config = GPIO_FindInputByName(name);
+    if (config == NULL || config->type != GPIO_TYPE_MCU) {
+        return HAL_ERROR;
+    }
+
+    int line = GPIO_PinNumber(config->GPIO_Pin);
+    if (exti_owner[line] != config - gpio_pins || exti_hook[line] != NULL) {
+        return HAL_ERROR;
+    }
+
+    EXTI->IMR &= ~(1U << line);
+    EXTI->RTSR &= ~(1U << line);
+    EXTI->FTSR &= ~(1U << line);
+    EXTI->PR = (1U << line);
+    exti_owner[line] = -1;
+    return HAL_OK;
+}
+
+/**
+ * @brief Route both edges of an MCU input to a callback instead of the event log
+ *
+ * Only the EXTI routing is touched, the pin mode is left alone so the pin
+ * can stay on an alternate function (e.g. a timer input) while hooked.
+ * The hook runs in the EXTI interrupt with the level read at entry.
+ * @param config: MCU input to hook
+ * @param hook: Callback, or NULL to release the line
+ * @return HAL_OK, HAL_BUSY if the line is armed or hooked by someone else
+ */
+HAL_StatusTypeDef GPIO_SetEdgeHook(const GPIO_InputConfig* config, GPIO_EdgeHook hook) {
+    if (config == NULL || config->type != GPIO_TYPE_MCU || config->dir != GPIO_DIR_INPUT) {
+        return HAL_ERROR;
+    }
+
+    int line = GPIO_PinNumber(config->GPIO_Pin);
+    int index = config - gpio_pins;
+    uint32_t bit = 1U << line;
+
+    if (hook == NULL) {
+        if (exti_owner[line] == index && exti_hook[line] != NULL) {
+            EXTI->IMR &= ~bit;
+            EXTI->RTSR &= ~bit;
+            EXTI->FTSR &= ~bit;
+            EXTI->PR = bit;
+            exti_hook[line] = NULL;
+            exti_owner[line] = -1;
+        }
+        return HAL_OK;
+    }
+
+    if (exti_owner[line] >= 0) {
+        return HAL_BUSY;
+    }
+
+    exti_owner[line] = index;
+    exti_hook[line] = hook;
+
+    __HAL_RCC_SYSCFG_CLK_ENABLE();
+    SYSCFG->EXTICR[line >> 2] = (SYSCFG->EXTICR[line >> 2] & ~(0xFU << (4 * (line & 3)))) |
+                                (GPIO_GET_INDEX(config->GPIOx) << (4 * (line & 3)));
+    EXTI->PR = bit;
+    EXTI->RTSR |= bit;
+    EXTI->FTSR |= bit;
+    EXTI->IMR |= bit;
+
+    HAL_NVIC_SetPriority(GPIO_ExtiIRQn(line), 0, 0);
+    HAL_NVIC_EnableIRQ(GPIO_ExtiIRQn(line));
+    return HAL_OK;
+}
+
+/**
+ * @brief Send events to the host as they happen instead of on request
+ */
+void GPIO_SetEventPush(bool enable) {
+    event_push = enable;
+}
+
+bool GPIO_GetEventPush(void) {
+    return event_push;
+}
+
+static bool GPIO_PopEvent(GPIO_InputEvent* event) {
+    if (event_tail == event_head) {
+        return false;
+    }
+    *event = event_buffer[event_tail];
+    event_tail = (event_tail + 1) % GPIO_EVENT_BUFFER_SIZE;
+    return true;
+}
+
+/**
+ * @brief Drain the event ring into buffer, one line per event
+ */
+void GPIO_PrintEvents(char *buffer) {
+    GPIO_InputEvent event;
+
+    while (GPIO_PopEvent(&event)) {
+        sprintf(tStr, "%s %s %lu\n", gpio_pins[event.pin_index].name,
+                event.level ? "HIGH" : "LOW", (unsigned long)event.timestamp_us);
+        strcat(buffer, tStr);
+    }
+    if (event_overflows) {
+        sprintf(tStr, "OVERFLOW %lu\n", (unsigned long)event_overflows);
+        strcat(buffer, tStr);
+        event_overflows = 0;
+    }
+}
+
+/**
+ * @brief Push pending events to the host, called from the main loop
+ */
+void GPIO_ProcessEvents(void) {
+    GPIO_InputEvent event;
+    char msg[48];
+
+    if (!event_push) {
+        return;
+    }
+    while (GPIO_PopEvent(&event)) {
+        sprintf(msg, "%s %s %lu", gpio_pins[event.pin_index].name,
+                event.level ? "HIGH" : "LOW", (unsigned long)event.timestamp_us);
+        sendReply("EVENT", msg);
+    }
+}
+
+// ******************************************************************
+// Input debounce and glitch capture
+// ******************************************************************
+
+/**
+ * @brief Feed one raw sample or edge into the debounce state of an input
+ *
+ * Runs from EXTI and SysTick, which share priority 0 and cannot preempt
+ * each other. A pulse away from the stable level that returns before the
+ * window expires counts as a glitch.
+ */
+static void GPIO_DebounceUpdate(int index, uint8_t level, uint32_t now) {
+    GPIO_DebounceState* db = &debounce[index];
+
+    if (level != db->raw) {
+        if (level == db->stable && (now - db->last_edge_us) < db->debounce_us) {
+            db->glitches++;
+        }
+        db->raw = level;
+        db->last_edge_us = now;
+    }
+    if (db->raw != db->stable && (now - db->last_edge_us) >= db->debounce_us) {
+        db->stable = db->raw;
+    }
+}
+
+/**
+ * @brief Sample every MCU input, called from SysTick every 1 ms
+ *
+ * Inputs armed with EXTI also get exact edge times from the interrupt;
+ * this sampler covers the rest and settles the debounced level.
+ */
+void GPIO_InputTick(void) {
+    uint32_t now = micros();
+
+    for (int i = 0; i < GPIO_PIN_COUNT; i++) {
+        if (gpio_pins[i].dir != GPIO_DIR_INPUT || gpio_pins[i].type != GPIO_TYPE_MCU) continue;
+        uint8_t level = (gpio_pins[i].GPIOx->IDR & gpio_pins[i].GPIO_Pin) ? 1 : 0;
+        GPIO_DebounceUpdate(i, level, now);
+    }
+}
+
+/**
+ * @brief Set the debounce window of an input
+ * @param name: Name of the input pin
+ * @param debounce_us: Window in microseconds, 0 reads the pin directly
+ * @return HAL_ERROR if the input is unknown
+ */
+HAL_StatusTypeDef GPIO_SetDebounce(const char* name, uint32_t debounce_us) {
+    const GPIO_InputConfig* config = GPIO_FindInputByName(name);
+    if (config == NULL || config->type != GPIO_TYPE_MCU) {
+        return HAL_ERROR;
+    }
+
+    GPIO_DebounceState* db = &debounce[config - gpio_pins];
+    __disable_irq();
+    db->debounce_us = debounce_us;
+    db->glitches = 0;
+    __enable_irq();
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef GPIO_GetDebounce(const char* name, uint32_t* debounce_us) {
+    const GPIO_InputConfig* config = GPIO_FindInputByName(name);
+    if (config == NULL || debounce_us == NULL) {
+        return HAL_ERROR;
+    }
+    *debounce_us = debounce[config - gpio_pins].debounce_us;
+    return HAL_OK;
+}
+
+/**
+ * @brief Get the raw level of an MCU input and when it last changed
+ * @param config: Input pin
+ * @param level: Raw level (0/1)
+ * @param when_us: micros() of the last change, exact for inputs armed with
+ *                 EXTI events, otherwise from the 1 ms sampler
+ * @return HAL_ERROR if not an MCU input
+ */
+HAL_StatusTypeDef GPIO_GetLastEdge(const GPIO_InputConfig* config, uint8_t* level, uint32_t* when_us) {
+    if (config == NULL || config->dir != GPIO_DIR_INPUT || config->type != GPIO_TYPE_MCU) {
+        return HAL_ERROR;
+    }
+
+    GPIO_DebounceState* db = &debounce[config - gpio_pins];
+    __disable_irq();
+    *level = db->raw;
+    *when_us = db->last_edge_us;
+    __enable_irq();
+    return HAL_OK;
+}
+
+// ******************************************************************
+// Waits for input conditions (WAIT command)
+// ******************************************************************
+static GPIO_InputWait input_waits[GPIO_WAIT_MAX];
+
+/**
+ * @brief Check a wait against the input's debounce state
+ * @param wait: Active wait
+ * @param elapsed_us: Time from the start of the wait until the level settled
+ * @return true once the debounced level matches
+ *
+ * The settle time is the raw edge plus the debounce window, so the result
+ * does not depend on how often the main loop checks.
+ */
+static bool GPIO_WaitMet(const GPIO_InputWait* wait, uint32_t* elapsed_us) {
+    const GPIO_DebounceState* db = &debounce[wait->config - gpio_pins];
+    uint8_t want = (wait->active == (wait->config->activeState == GPIO_PIN_SET)) ? 1 : 0;
+    uint8_t level;
+    uint32_t settled;
+
+    __disable_irq();
+    level = db->debounce_us ? db->stable : db->raw;
+    settled = db->last_edge_us + db->debounce_us;
+    __enable_irq();
+
+    if (level != want) {
+        return false;
+    }
+    int32_t elapsed = (int32_t)(settled - wait->start_us);
+    *elapsed_us = elapsed > 0 ? (uint32_t)elapsed : 0;
+    return true;
+}
+
+static void GPIO_WaitReply(const GPIO_InputWait* wait, bool met, uint32_t elapsed_us) {
+    char msg[40];
+    if (met) {
+        sprintf(msg, "%s %lu", wait->config->name, (unsigned long)elapsed_us);
+    } else {
+        sprintf(msg, "%s TIMEOUT", wait->config->name);
+    }
+    sendReply("WAIT", msg);
+}
+
+/**
+ * @brief Wait for an MCU input to reach a debounced state
+ * @param name: Input pin name
+ * @param active: true to wait for ACTIVE, false for INACTIVE
+ * @param timeout_ms: Give up after this long
+ * @return HAL_OK if answered or queued, HAL_BUSY if the input already has a
+ *         wait pending or all wait slots are used, HAL_ERROR for an unknown input
+ *
+ * Replies {"WAIT" : "<name> <elapsed_us>"} or "<name> TIMEOUT", immediately
+ * if the condition already holds, otherwise from GPIO_ProcessWaits(). Every
+ * queued wait gets exactly one reply, so a pending one is never replaced.
+ */
+HAL_StatusTypeDef GPIO_StartWait(const char* name, bool active, uint32_t timeout_ms) {
+    const GPIO_InputConfig* config = GPIO_FindInputByName(name);
+    GPIO_InputWait* slot = NULL;
+    uint32_t elapsed_us;
+
+    if (config == NULL || config->type != GPIO_TYPE_MCU) {
+        return HAL_ERROR;
+    }
+
+    for (int i = 0; i < GPIO_WAIT_MAX; i++) {
+        if (input_waits[i].config == config) {
+            return HAL_BUSY;
+        }
+        if (slot == NULL && input_waits[i].config == NULL) {
+            slot = &input_waits[i];
+        }
+    }
+    if (slot == NULL) {
+        return HAL_BUSY;
+    }
+
+    slot->config = config;
+    slot->active = active;
+    slot->start_us = micros();
+    slot->start_ms = millis();
+    slot->timeout_ms = timeout_ms;
+
+    if (GPIO_WaitMet(slot, &elapsed_us)) {
+        GPIO_WaitReply(slot, true, elapsed_us);
+        slot->config = NULL;
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Answer waits that are met or timed out, called from the main loop
+ */
+void GPIO_ProcessWaits(void) {
+    uint32_t elapsed_us;
+
+    for (int i = 0; i < GPIO_WAIT_MAX; i++) {
+        GPIO_InputWait* wait = &input_waits[i];
+        if (wait->config == NULL) continue;
+
+        if (GPIO_WaitMet(wait, &elapsed_us)) {
+            GPIO_WaitReply(wait, true, elapsed_us);
+            wait->config = NULL;
+        } else if (millis() - wait->start_ms > wait->timeout_ms) {
+            GPIO_WaitReply(wait, false, 0);
+            wait->config = NULL;
+        }
+    }
+}
+
+/**
+ * @brief Print debounce window, debounced level and glitch count per input
+ */
+void GPIO_PrintGlitches(char *buffer) {
+    sprintf(tStr, "%-15s | %-10s | %-6s | %s\n", "NAME", "WINDOW_US", "STABLE", "GLITCHES");
+    strcat(buffer, tStr);
+    strcat(buffer, "--------------------------------------------------\n");
+
+    for (int i = 0; i < GPIO_PIN_COUNT; i++) {
+        if (gpio_pins[i].dir != GPIO_DIR_INPUT || gpio_pins[i].type != GPIO_TYPE_MCU) continue;
+        sprintf(tStr, "%-15s | %-10lu | %-6s | %lu\n",
+                gpio_pins[i].name,
+                (unsigned long)debounce[i].debounce_us,
+                debounce[i].stable ? "HIGH" : "LOW",
+                (unsigned long)debounce[i].glitches);
+        strcat(buffer, tStr);
+    }
+}
+
+void GPIO_ClearGlitches(void) {
+    for (int i = 0; i < GPIO_PIN_COUNT; i++) {
+        debounce[i].glitches = 0;
+    }
+}
+
+/**
+ * @brief Record every pending EXTI line in lines
+ *
+ * The timestamp is taken once on entry so that simultaneous edges share it.
+ */
+static void GPIO_EXTI_Dispatch(uint32_t lines) {
+    uint32_t now = micros();
+    uint32_t pending = EXTI->PR & lines;
+
+    EXTI->PR = pending;  // Write 1 to clear
+
+    for (int line = 0; pending != 0; line++) {
+        uint32_t bit = 1U << line;
+        if ((pending & bit) == 0) continue;
+        pending &= ~bit;
+
+        int index = exti_owner[line];
+        if (index < 0) continue;
+
+        uint8_t level = (gpio_pins[index].GPIOx->IDR & gpio_pins[index].GPIO_Pin) ? 1 : 0;
+        if (exti_hook[line] != NULL) {
+            exti_hook[line](level, now);
+            continue;
+        }
+        GPIO_DebounceUpdate(index, level, now);
+
+        uint16_t next = (event_head + 1) % GPIO_EVENT_BUFFER_SIZE;
+        if (next == event_tail) {
+            event_overflows++;
+            continue;
+        }
+        event_buffer[event_head].timestamp_us = now;
+        event_buffer[event_head].pin_index = index;
+        event_buffer[event_head].level = level;
+        event_head = next;
+    }
+}
+
+void EXTI0_1_IRQHandler(void) {
+    GPIO_EXTI_Dispatch(0x0003);
+}
+
+void EXTI2_3_IRQHandler(void) {
+    GPIO_EXTI_Dispatch(0x000C);
+}
+
+void EXTI4_15_IRQHandler(void) {
+    GPIO_EXTI_Dispatch(0xFFF0);
+}
+
 void updateLEDStatus(void) {
     led_state = !led_state;
     HAL_GPIO_WritePin(LED2_GPIO_PORT, LED2_PIN, (led_state ? GPIO_PIN_SET : GPIO_PIN_RESET));
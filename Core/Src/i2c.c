@@ -20,6 +20,8 @@
 #include "utils.h"
 #include "main.h"
 #include "i2c.h"
+#include "gpio.h"
+#include "command.h"
 
 I2C_HandleTypeDef hi2c1;
 I2C_HandleTypeDef hi2c2;
@@ -80,15 +82,44 @@ void MX_I2C1_Init(void)
   }
 }
 
-/**
-  * @brief I2C2 Initialization Function
-  * @param None
-  * @retval None
-  */
-void MX_I2C2_Init(void)
+// ******************************************************************
+// I2C2 master (PCA9534)
+// ******************************************************************
+static I2C_MasterXfer master_queue[I2C_MASTER_QUEUE_SIZE];
+static volatile uint8_t master_head = 0;       // Oldest entry, the one in flight when active
+static volatile uint8_t master_count = 0;
+static volatile bool master_active = false;
+static volatile uint32_t master_start_ms;      // HAL_GetTick() when the active entry started
+static uint32_t master_speed_khz = I2C_MASTER_DEFAULT_KHZ;
+
+// Bus recovery, run one step per SysTick so no interrupt holds the CPU for long
+typedef enum {
+  I2C_RECOVER_NONE,
+  I2C_RECOVER_PENDING,        // Requested, peripheral not yet released
+  I2C_RECOVER_PULSING         // Clocking SCL by hand until SDA is released
+} I2C_RecoverState;
+
+static volatile I2C_RecoverState master_recover = I2C_RECOVER_NONE;
+static uint8_t master_recover_pulses;
+
+volatile I2C_BusStats i2c_stats[I2C_BUS_COUNT];
+
+// TIMINGR values for a 48 MHz I2C clock (I2C2 PCLK, I2C1 SYSCLK above 100 kHz), analog filter on
+static uint32_t I2C_MasterTiming(uint32_t khz)
+{
+  switch (khz) {
+    case 100:  return 0x20303E5D;
+    case 400:  return 0x2010091A;
+    case 1000: return 0x00700818;
+    default:   return 0;
+  }
+}
+
+/* Apply hi2c2.Init with the selected speed; used at start-up, on speed changes and after a timeout */
+static HAL_StatusTypeDef I2C_MasterConfigure(void)
 {
   hi2c2.Instance = I2C2;
-  hi2c2.Init.Timing = 0x20303E5D;
+  hi2c2.Init.Timing = I2C_MasterTiming(master_speed_khz);
   hi2c2.Init.OwnAddress1 = 0;
   hi2c2.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
   hi2c2.Init.DualAddressMode = I2C_DUALADDRESS_DISABLE;
@@ -98,20 +129,344 @@ void MX_I2C2_Init(void)
   hi2c2.Init.NoStretchMode = I2C_NOSTRETCH_DISABLE;
   if (HAL_I2C_Init(&hi2c2) != HAL_OK)
   {
-    Error_Handler();
+    return HAL_ERROR;
   }
 
   // Configure Analog filter
   if (HAL_I2CEx_ConfigAnalogFilter(&hi2c2, I2C_ANALOGFILTER_ENABLE) != HAL_OK)
   {
-    Error_Handler();
+    return HAL_ERROR;
   }
 
   // Configure Digital filter
   if (HAL_I2CEx_ConfigDigitalFilter(&hi2c2, 0) != HAL_OK)
   {
-    Error_Handler();
+    return HAL_ERROR;
+  }
+
+  // Fast-mode Plus needs the stronger pad drivers
+  if (master_speed_khz >= 1000) {
+    HAL_I2CEx_EnableFastModePlus(I2C_FASTMODEPLUS_I2C2);
+  } else {
+    HAL_I2CEx_DisableFastModePlus(I2C_FASTMODEPLUS_I2C2);
+  }
+
+  HAL_NVIC_SetPriority(I2C2_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(I2C2_IRQn);
+  return HAL_OK;
+}
+
+/**
+  * @brief I2C2 Initialization Function
+  * @param None
+  * @retval None
+  */
+void MX_I2C2_Init(void)
+{
+  // A held bus is recovered rather than halting the tester; queued transfers wait for it
+  if (I2C_MasterConfigure() != HAL_OK || __HAL_I2C_GET_FLAG(&hi2c2, I2C_FLAG_BUSY))
+  {
+    if(DEBUG_I2C) printf("I2C2: bus not idle at init, recovering\n");
+    master_recover = I2C_RECOVER_PENDING;
+  }
+}
+
+/* Count the HAL error bits for one bus */
+static void I2C_CountErrors(volatile I2C_BusStats* stats, uint32_t error)
+{
+  if (error & HAL_I2C_ERROR_AF)   stats->nack++;
+  if (error & HAL_I2C_ERROR_ARLO) stats->arbitration++;
+  if (error & HAL_I2C_ERROR_BERR) stats->bus_error++;
+  if (error & HAL_I2C_ERROR_OVR)  stats->overrun++;
+}
+
+static void I2C_BusDelay(uint32_t us)
+{
+  uint32_t start = micros();
+  while (micros() - start < us) {
+  }
+}
+
+/**
+ * @brief Advance I2C2 bus recovery by one step
+ *
+ * PENDING: take PB10/PB11 from the peripheral as open-drain outputs.
+ * PULSING: while SDA is held low, give one SCL pulse per call (up to nine,
+ * enough for a slave to finish any byte), then send a STOP and hand the
+ * pins back to a freshly initialised I2C2.
+ */
+static void I2C_MasterRecoverStep(void)
+{
+  if (master_recover == I2C_RECOVER_PENDING) {
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    HAL_I2C_DeInit(&hi2c2);
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+    HAL_GPIO_WritePin(I2C2_BUS_PORT, I2C2_SCL_PIN | I2C2_SDA_PIN, GPIO_PIN_SET);
+    GPIO_InitStruct.Pin = I2C2_SCL_PIN | I2C2_SDA_PIN;
+    GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_OD;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+    HAL_GPIO_Init(I2C2_BUS_PORT, &GPIO_InitStruct);
+
+    master_recover_pulses = I2C_RECOVER_PULSES;
+    master_recover = I2C_RECOVER_PULSING;
+    i2c_stats[I2C_BUS_MASTER].recoveries++;
+    return;
+  }
+
+  if (master_recover_pulses > 0 &&
+      HAL_GPIO_ReadPin(I2C2_BUS_PORT, I2C2_SDA_PIN) == GPIO_PIN_RESET) {
+    HAL_GPIO_WritePin(I2C2_BUS_PORT, I2C2_SCL_PIN, GPIO_PIN_RESET);
+    I2C_BusDelay(I2C_RECOVER_HALF_US);
+    HAL_GPIO_WritePin(I2C2_BUS_PORT, I2C2_SCL_PIN, GPIO_PIN_SET);
+    I2C_BusDelay(I2C_RECOVER_HALF_US);
+    master_recover_pulses--;
+    return;
+  }
+
+  // START then STOP (SDA low, then high, with SCL high) resets every slave's bus logic
+  HAL_GPIO_WritePin(I2C2_BUS_PORT, I2C2_SDA_PIN, GPIO_PIN_RESET);
+  I2C_BusDelay(I2C_RECOVER_HALF_US);
+  HAL_GPIO_WritePin(I2C2_BUS_PORT, I2C2_SDA_PIN, GPIO_PIN_SET);
+  I2C_BusDelay(I2C_RECOVER_HALF_US);
+
+  // HAL_I2C_Init runs the MSP init, which returns the pins to I2C2
+  I2C_MasterConfigure();
+  master_recover = I2C_RECOVER_NONE;
+}
+
+/* Retire the active entry and run its callback. The slot is freed first so the callback may submit. */
+static void I2C_MasterFinish(HAL_StatusTypeDef status)
+{
+  I2C_MasterXfer* xfer = &master_queue[master_head];
+  I2C_MasterCallback callback = xfer->callback;
+  void* context = xfer->context;
+
+  if (status == HAL_OK && xfer->read && xfer->rx != NULL) {
+    memcpy(xfer->rx, xfer->data, xfer->length);
+  }
+
+  master_head = (master_head + 1) % I2C_MASTER_QUEUE_SIZE;
+  master_count--;
+  master_active = false;
+
+  if (callback != NULL) {
+    callback(status, context);
+  }
+}
+
+/* Start the oldest queued entry if the bus is free. Entries that fail to start are retired with the error. */
+static void I2C_MasterStartNext(void)
+{
+  while (!master_active && master_recover == I2C_RECOVER_NONE && master_count > 0) {
+    I2C_MasterXfer* xfer = &master_queue[master_head];
+    HAL_StatusTypeDef status;
+
+    master_active = true;
+    master_start_ms = HAL_GetTick();
+    if (xfer->read) {
+      status = HAL_I2C_Mem_Read_IT(&hi2c2, xfer->dev_address, xfer->reg, I2C_MEMADD_SIZE_8BIT,
+                                   xfer->data, xfer->length);
+    } else {
+      status = HAL_I2C_Mem_Write_IT(&hi2c2, xfer->dev_address, xfer->reg, I2C_MEMADD_SIZE_8BIT,
+                                    xfer->data, xfer->length);
+    }
+
+    if (status != HAL_OK) {
+      // Someone is holding the bus; fail this entry and recover before the next
+      if (__HAL_I2C_GET_FLAG(&hi2c2, I2C_FLAG_BUSY)) {
+        master_recover = I2C_RECOVER_PENDING;
+      }
+      I2C_MasterFinish(status);
+    }
+  }
+}
+
+/**
+ * @brief Queue a register transaction on I2C2
+ * @param xfer: Transaction to copy into the queue
+ * @return HAL_OK if queued, HAL_BUSY if the queue is full, HAL_ERROR on bad parameters
+ *
+ * Safe to call from interrupt context. The callback runs from the I2C2 or
+ * SysTick interrupt once the transaction completes, fails or times out.
+ */
+HAL_StatusTypeDef I2C_MasterSubmit(const I2C_MasterXfer* xfer)
+{
+  if (xfer == NULL || xfer->length == 0 || xfer->length > I2C_MASTER_MAX_DATA) {
+    return HAL_ERROR;
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  if (master_count >= I2C_MASTER_QUEUE_SIZE) {
+    __set_PRIMASK(primask);
+    return HAL_BUSY;
+  }
+
+  I2C_MasterXfer* slot = &master_queue[(master_head + master_count) % I2C_MASTER_QUEUE_SIZE];
+  *slot = *xfer;
+  if (slot->timeout_ms == 0) {
+    slot->timeout_ms = I2C_MASTER_TIMEOUT_MS;
+  }
+  master_count++;
+  I2C_MasterStartNext();
+
+  __set_PRIMASK(primask);
+  return HAL_OK;
+}
+
+typedef struct {
+  volatile bool done;
+  volatile HAL_StatusTypeDef status;
+} I2C_MasterWait;
+
+static void I2C_MasterWaitCallback(HAL_StatusTypeDef status, void* context)
+{
+  I2C_MasterWait* wait = (I2C_MasterWait*)context;
+  wait->status = status;
+  wait->done = true;
+}
+
+/* Queue a transaction and wait for it; completion is guaranteed by the per-transaction timeout. */
+static HAL_StatusTypeDef I2C_MasterTransfer(uint16_t dev_address, uint8_t reg, bool read,
+                                            uint8_t* data, uint8_t length)
+{
+  I2C_MasterWait wait = { false, HAL_ERROR };
+  I2C_MasterXfer xfer = {0};
+
+  // Waiting needs the I2C2 and SysTick interrupts to run
+  if (__get_IPSR() != 0 || __get_PRIMASK() != 0 || length > I2C_MASTER_MAX_DATA) {
+    return HAL_ERROR;
+  }
+
+  xfer.dev_address = dev_address;
+  xfer.reg = reg;
+  xfer.read = read;
+  xfer.length = length;
+  xfer.rx = read ? data : NULL;
+  xfer.callback = I2C_MasterWaitCallback;
+  xfer.context = &wait;
+  if (!read) {
+    memcpy(xfer.data, data, length);
+  }
+
+  HAL_StatusTypeDef status = I2C_MasterSubmit(&xfer);
+  if (status != HAL_OK) {
+    return status;
+  }
+  while (!wait.done) {
+  }
+  return wait.status;
+}
+
+HAL_StatusTypeDef I2C_MasterWriteReg(uint16_t dev_address, uint8_t reg, const uint8_t* data, uint8_t length)
+{
+  return I2C_MasterTransfer(dev_address, reg, false, (uint8_t*)data, length);
+}
+
+HAL_StatusTypeDef I2C_MasterReadReg(uint16_t dev_address, uint8_t reg, uint8_t* data, uint8_t length)
+{
+  return I2C_MasterTransfer(dev_address, reg, true, data, length);
+}
+
+/**
+ * @brief Time out the active transaction and run bus recovery
+ *
+ * Called every 1 ms from SysTick. A transaction past its timeout is failed
+ * with HAL_TIMEOUT and the bus is recovered before the queue moves on.
+ */
+void I2C_MasterTick(void)
+{
+  if (master_active && HAL_GetTick() - master_start_ms > master_queue[master_head].timeout_ms) {
+    i2c_stats[I2C_BUS_MASTER].timeout++;
+    master_recover = I2C_RECOVER_PENDING;
+    I2C_MasterFinish(HAL_TIMEOUT);
+  }
+
+  if (master_recover != I2C_RECOVER_NONE) {
+    I2C_MasterRecoverStep();
+    I2C_MasterStartNext();
+  }
+}
+
+/**
+ * @brief Change the I2C2 bus speed
+ * @param khz: 100, 400 or 1000
+ * @return HAL_OK, HAL_ERROR for an unsupported speed, HAL_BUSY if the queue did not drain
+ */
+HAL_StatusTypeDef I2C_MasterSetSpeed(uint32_t khz)
+{
+  if (I2C_MasterTiming(khz) == 0) {
+    return HAL_ERROR;
   }
+
+  uint32_t start = HAL_GetTick();
+  while (master_count > 0 || master_recover != I2C_RECOVER_NONE) {
+    if (HAL_GetTick() - start > I2C_MASTER_QUEUE_SIZE * I2C_MASTER_TIMEOUT_MS + I2C_RECOVER_PULSES + 2) {
+      return HAL_BUSY;
+    }
+  }
+
+  __disable_irq();
+  master_speed_khz = khz;
+  HAL_I2C_DeInit(&hi2c2);
+  HAL_StatusTypeDef status = I2C_MasterConfigure();
+  __enable_irq();
+
+  if(DEBUG_I2C) printf("I2C2 speed set to %lu kHz\n", (unsigned long)khz);
+  return status;
+}
+
+uint32_t I2C_MasterGetSpeed(void)
+{
+  return master_speed_khz;
+}
+
+// ******************************************************************
+// I2C IRQs
+// ******************************************************************
+// HCLK cycles spent in I2C1_IRQHandler, timed on the SysTick down-counter (M0 has no cycle counter)
+static volatile uint32_t i2c1_irq_cycles = 0;
+
+void I2C1_IRQHandler(void)
+{
+    uint32_t start = SysTick->VAL;
+
+    HAL_I2C_EV_IRQHandler(&hi2c1);
+    HAL_I2C_ER_IRQHandler(&hi2c1);
+
+    uint32_t end = SysTick->VAL;
+    i2c1_irq_cycles += (start >= end) ? start - end : start + SysTick->LOAD + 1 - end;
+}
+
+void I2C2_IRQHandler(void)
+{
+    HAL_I2C_EV_IRQHandler(&hi2c2);
+    HAL_I2C_ER_IRQHandler(&hi2c2);
+}
+
+/**
+ * @brief Register write complete (I2C2 master queue)
+ * @param hi2c Pointer to I2C handle
+ */
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c) {
+    if (hi2c->Instance == I2C2 && master_active) {
+        I2C_MasterFinish(HAL_OK);
+        I2C_MasterStartNext();
+    }
+}
+
+/**
+ * @brief Register read complete (I2C2 master queue)
+ * @param hi2c Pointer to I2C handle
+ */
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c) {
+    if (hi2c->Instance == I2C2 && master_active) {
+        I2C_MasterFinish(HAL_OK);
+        I2C_MasterStartNext();
+    }
 }
 
 /*
@@ -128,44 +483,196 @@ void MX_I2C2_Init(void)
 #include <stdio.h>
 #include <stdbool.h>
 
-// Define register addresses
-#define REG_0       0x00
-#define REG_1       0x01
-#define NUM_REGS    2
+/*
+ * Slave register file
+ *
+ * A master write sends the register pointer, then any number of data bytes;
+ * a master read returns bytes from the pointer on. Either way the pointer
+ * auto-increments and wraps at the map size, and it persists between
+ * transactions, so a read without a preceding pointer write continues where
+ * the last access stopped (repeated start or not).
+ *
+ * Data bytes move straight between the bus and slave_memory: each burst
+ * is one HAL sequential transfer covering the rest of the map, restarted at
+ * register 0 when it reaches the end. How far the master actually got is
+ * taken from the HAL buffer pointer when the burst ends. The HAL reports a
+ * burst shorter than the transfer as an AF error, so on this bus AF is the
+ * normal end of a burst, not a fault. On reads one byte beyond the last one
+ * acknowledged has already been loaded into TXDR and is discarded.
+ *
+ * In EEPROM mode the same memory behaves like a 24Cxx: a 1 or 2 byte word
+ * address, sequential reads that roll over the whole array, and page writes
+ * that roll over within the page. Written bytes collect in eeprom_page and
+ * are committed at STOP (a repeated start abandons them, as on the real
+ * part), after which the own address is disabled for the write cycle so the
+ * master's acknowledge polling sees NACKs.
+ *
+ * OA1 and OA2 each answer as their own device with its own map or EEPROM,
+ * carved from the two ends of slave_memory. OA2 can ignore up to 7 low
+ * address bits; the ignored bits of the address the master used then pick
+ * an equal bank of the OA2 device, which gives one register file per
+ * address in the range, or the block select of a 24C04/08/16.
+ *
+ * Fault injection (I2C_SetSlaveInject) works off the same callbacks. The
+ * HAL leaves ADDR set, and so SCL low, until the data transfer is started,
+ * so a stretch simply defers that call: short ones spin in the interrupt,
+ * longer ones are released from the TIM2 CC3 interrupt against micros().
+ * An injected NACK stops the receive one byte short and sets NACK from
+ * that byte's interrupt, while the next byte is still being clocked in.
+ */
 
 // I2C slave state machine states
 typedef enum {
     I2C_SLAVE_IDLE,         // Waiting for address match
-    I2C_SLAVE_REG_ADDR,     // Received register address
-    I2C_SLAVE_REG_READ,     // Preparing to read from register
-    I2C_SLAVE_REG_WRITE     // Writing to register
+    I2C_SLAVE_REG_ADDR,     // Receiving the register pointer
+    I2C_SLAVE_REG_READ,     // Master reading from the pointer on
+    I2C_SLAVE_REG_WRITE     // Master writing from the pointer on
 } I2C_SlaveState;
 
-// Global variables for I2C slave operation
-static uint8_t slave_registers[NUM_REGS] = {0x00, 0x00};  // Register values
-static uint8_t current_reg_addr = 0;                      // Currently selected register
-static I2C_SlaveState slave_state = I2C_SLAVE_IDLE;       // State machine state
+// One emulated device per own address
+typedef struct {
+    uint16_t base;              // Offset of its memory in slave_memory
+    uint16_t size;              // Map or EEPROM size
+    uint16_t pointer;           // Register pointer / EEPROM address counter
+    I2C_EepromConfig eeprom;    // EEPROM mode, size 0 = register mode
+    volatile bool busy;         // EEPROM write cycle running, address disabled
+    volatile uint32_t busy_ms;  // HAL_GetTick() at the start of the cycle
+    volatile uint32_t writes;   // EEPROM page writes committed
+} I2C_SlaveDevice;
 
-// Buffer for receiving data
-static uint8_t rx_buffer[2];  // One byte for reg address, one for data
+// Global variables for I2C slave operation
+static uint8_t slave_memory[I2C_SLAVE_MEM_SIZE];            // Register values or EEPROM arrays
+static I2C_SlaveDevice slave_devs[I2C_SLAVE_DEV_COUNT] = {
+    { .base = 0, .size = I2C_REG_FILE_SIZE },
+    { .base = I2C_SLAVE_MEM_SIZE - I2C_REG_FILE_SIZE, .size = I2C_REG_FILE_SIZE },
+};
+static uint8_t slave_oa2_address = 0;                       // 7-bit OA2, 0 = off
+static uint8_t slave_oa2_mask_bits = 0;                     // Low address bits OA2 ignores
+static volatile I2C_SlaveState slave_state = I2C_SLAVE_IDLE; // State machine state
+static volatile bool slave_reset_pending = false;           // Error needs a re-init from I2C_Process()
+static volatile uint32_t slave_rx_bytes = 0;                // Data bytes written by the master
+static volatile uint32_t slave_tx_bytes = 0;                // Data bytes read by the master
+static volatile uint32_t slave_xfers = 0;                   // Transactions ended (as logged)
+static uint32_t slave_speed_khz = I2C_SLAVE_DEFAULT_KHZ;    // Bus speed the timing is set for
+
+// Buffer for receiving the register pointer (word address in EEPROM mode)
+static uint8_t rx_buffer[2];
+
+// Page write buffer, committed at STOP
+static uint8_t eeprom_page[I2C_EEPROM_PAGE_MAX];
+
+// Current transaction, logged when it ends
+static uint32_t slave_xfer_us;                              // micros() at the address match
+static uint8_t slave_xfer_addr;                             // 7-bit address matched
+static I2C_SlaveDevice* slave_dev = &slave_devs[0];         // Device that address selects
+static uint16_t slave_win_base;                             // Device offset of the addressed bank
+static uint16_t slave_win_size;                             // Bank size, the pointer wraps here
+static uint16_t slave_burst_reg;                            // Pointer at the first data byte
+static uint32_t slave_burst_bytes;                          // Bytes moved before the current segment
+
+// Buffer the current data burst runs over (the bank, or the EEPROM page buffer)
+static uint8_t* slave_seg_base;
+static uint16_t slave_seg_span;                             // Its size, the burst wraps to its start here
+static uint16_t slave_seg_pos;                              // Index of the first byte of this segment
+
+// Fault injection, see I2C_SetSlaveInject
+static I2C_SlaveInject slave_inject = { .nack_byte = I2C_INJECT_NACK_OFF };
+static volatile bool slave_stretching = false;              // ADDR held, released from TIM2 CC3
+static bool slave_xfer_read;                                // Direction of the address matched
+static uint16_t slave_xfer_stretch_us;                      // SCL held after the address match
+static int32_t slave_nack_left = -1;                        // Bytes to accept before the NACK, -1 = none
+static uint16_t slave_rx_armed;                             // Length of the receive in progress
+static bool slave_nacked;                                   // Rest of this write goes to slave_discard
+static uint8_t* slave_nack_ptr;                             // Where the NACKed byte would have gone
+static uint8_t slave_discard;
+
+// Transaction log, filled from the I2C1 interrupt and drained by I2C_LOG
+static I2C_SlaveLogEntry slave_log[I2C_SLAVE_LOG_SIZE];
+static volatile uint16_t slave_log_head = 0;
+static volatile uint16_t slave_log_tail = 0;
+static volatile uint32_t slave_log_overflows = 0;
+
+/* Banks the OA2 address range splits its device into, 1 for OA1 */
+static uint16_t I2C_SlaveBanks(I2C_SlaveDev dev) {
+    return dev == I2C_SLAVE_DEV_OA2 ? 1U << slave_oa2_mask_bits : 1U;
+}
 
 /**
- * @brief Set the I2C slave address
- * @param address: 7-bit slave address (0-127)
- * @return HAL_StatusTypeDef
+ * @brief Check a device layout against the bank count and the shared memory
+ * @param dev: Device to check
+ * @param size: Proposed map or EEPROM size
+ * @param eeprom: Proposed EEPROM geometry, NULL for register mode
+ * @param banks: Proposed bank count
+ * @return true if the layout fits
  */
-HAL_StatusTypeDef I2C_SetSlaveAddress(uint8_t address) {
-    // Validate address (7-bit addressing)
-    if (address > 127) {
-        if(DEBUG_I2C) printf("Error: Invalid slave address (must be 0-127)\n");
-        return HAL_ERROR;
+static bool I2C_SlaveLayoutOk(I2C_SlaveDev dev, uint16_t size, const I2C_EepromConfig* eeprom, uint16_t banks) {
+    uint16_t other = slave_devs[dev == I2C_SLAVE_DEV_OA1 ? I2C_SLAVE_DEV_OA2 : I2C_SLAVE_DEV_OA1].size;
+    uint16_t bank_size = size / banks;
+
+    if (size == 0 || size % banks != 0 || size > I2C_SLAVE_MEM_SIZE) {
+        return false;
+    }
+    // The devices only need to share memory while OA2 is on
+    if (slave_oa2_address != 0 && size + other > I2C_SLAVE_MEM_SIZE) {
+        return false;
+    }
+    if (eeprom == NULL) {
+        return bank_size <= I2C_REG_FILE_MAX;
+    }
+    return (eeprom->addr_bytes == 2 || (eeprom->addr_bytes == 1 && bank_size <= 256)) &&
+           eeprom->page != 0 && eeprom->page <= I2C_EEPROM_PAGE_MAX &&
+           (eeprom->page & (eeprom->page - 1)) == 0 && bank_size % eeprom->page == 0 &&
+           eeprom->write_ms <= I2C_EEPROM_MAX_WRITE_MS;
+}
+
+/*
+ * Drop a pending stretch release, the peripheral is being reset. Runs in
+ * the main loop: DIER is shared with the sequencer (CC2IE), so the
+ * read-modify-write is done with interrupts masked.
+ */
+static void I2C_SlaveStretchCancel(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    TIM2->DIER &= ~TIM_DIER_CC3IE;
+    slave_stretching = false;
+    __set_PRIMASK(primask);
+}
+
+/*
+ * Clock and timing for slave_speed_khz, applied before HAL_I2C_Init. As a
+ * slave only SDADEL/SCLDEL matter, but Fast-mode needs an I2C clock of at
+ * least 8 MHz and Fast-mode Plus about 18 MHz, so above 100 kHz I2C1 moves
+ * from the 8 MHz HSI to SYSCLK and shares the 48 MHz master values.
+ */
+static void I2C_SlaveClockConfig(void) {
+    if (slave_speed_khz == I2C_SLAVE_DEFAULT_KHZ) {
+        __HAL_RCC_I2C1_CONFIG(RCC_I2C1CLKSOURCE_HSI);
+        hi2c1.Init.Timing = 0x2000090E;
+    } else {
+        __HAL_RCC_I2C1_CONFIG(RCC_I2C1CLKSOURCE_SYSCLK);
+        hi2c1.Init.Timing = I2C_MasterTiming(slave_speed_khz);
     }
 
+    // Fast-mode Plus needs the stronger pad drivers
+    if (slave_speed_khz >= 1000) {
+        HAL_I2CEx_EnableFastModePlus(I2C_FASTMODEPLUS_I2C1);
+    } else {
+        HAL_I2CEx_DisableFastModePlus(I2C_FASTMODEPLUS_I2C1);
+    }
+}
+
+/* DeInit/Init with the current own addresses and go back to listening */
+static HAL_StatusTypeDef I2C_SlaveRestart(void) {
     // Stop any ongoing I2C operations
     HAL_I2C_DeInit(&hi2c1);
+    I2C_SlaveStretchCancel();
+    I2C_SlaveClockConfig();
 
-    // Re-initialize with new address
-    hi2c1.Init.OwnAddress1 = address << 1; // Shift left by 1 as per HAL requirement
+    hi2c1.Init.DualAddressMode = slave_oa2_address ? I2C_DUALADDRESS_ENABLE : I2C_DUALADDRESS_DISABLE;
+    hi2c1.Init.OwnAddress2 = slave_oa2_address << 1;
+    hi2c1.Init.OwnAddress2Masks = slave_oa2_mask_bits;
+    slave_devs[I2C_SLAVE_DEV_OA1].busy = false;
+    slave_devs[I2C_SLAVE_DEV_OA2].busy = false;
 
     if (HAL_I2C_Init(&hi2c1) != HAL_OK) {
         if(DEBUG_I2C) printf("Error: Failed to reinitialize I2C with new address\n");
@@ -178,44 +685,256 @@ HAL_StatusTypeDef I2C_SetSlaveAddress(uint8_t address) {
         if(DEBUG_I2C) printf("Error: Failed to enable listen mode\n");
         return HAL_ERROR;
     }
+    return HAL_OK;
+}
+
+/**
+ * @brief Set the I2C slave address
+ * @param address: 7-bit slave address (0-127)
+ * @return HAL_StatusTypeDef
+ */
+HAL_StatusTypeDef I2C_SetSlaveAddress(uint8_t address) {
+    // Validate address (7-bit addressing)
+    if (address > 127) {
+        if(DEBUG_I2C) printf("Error: Invalid slave address (must be 0-127)\n");
+        return HAL_ERROR;
+    }
+
+    // Re-initialize with new address
+    hi2c1.Init.OwnAddress1 = address << 1; // Shift left by 1 as per HAL requirement
+    if (I2C_SlaveRestart() != HAL_OK) {
+        return HAL_ERROR;
+    }
 
     if(DEBUG_I2C) printf("I2C slave address set to 0x%02X\n", address);
     return HAL_OK;
 }
 
+/**
+ * @brief Get the I2C slave address
+ * @return 7-bit address (OA1)
+ */
+uint8_t I2C_GetSlaveAddress(void) {
+    return (uint8_t)(hi2c1.Init.OwnAddress1 >> 1);
+}
+
+/**
+ * @brief Set or turn off the second own address
+ * @param address: 7-bit address, 0 to turn OA2 off; the whole masked range must be within 0x08-0x77
+ * @param mask_bits: Low address bits to ignore (0-7), each address in the range gets its own bank
+ * @return HAL_StatusTypeDef
+ */
+HAL_StatusTypeDef I2C_SetSecondAddress(uint8_t address, uint8_t mask_bits) {
+    I2C_SlaveDevice* dev = &slave_devs[I2C_SLAVE_DEV_OA2];
+    uint8_t old_address = slave_oa2_address;
+    uint32_t base = address & ~((1U << mask_bits) - 1);
+
+    // The aligned range base..base+2^mask_bits-1 is answered, not just address
+    if (mask_bits > 7 || (address != 0 &&
+        (base < I2C_OA2_ADDR_MIN || base + (1U << mask_bits) - 1 > I2C_OA2_ADDR_MAX))) {
+        if(DEBUG_I2C) printf("Error: Invalid OA2 address or mask (range must be within 0x08-0x77)\n");
+        return HAL_ERROR;
+    }
+
+    slave_oa2_address = address;
+    if (address != 0 && !I2C_SlaveLayoutOk(I2C_SLAVE_DEV_OA2, dev->size, dev->eeprom.size ? &dev->eeprom : NULL,
+                                           1U << mask_bits)) {
+        if(DEBUG_I2C) printf("Error: OA2 map does not fit %u banks\n", 1U << mask_bits);
+        slave_oa2_address = old_address;
+        return HAL_ERROR;
+    }
+
+    // Masked bits are don't-care, keep the range base aligned
+    slave_oa2_address = (uint8_t)base;
+    slave_oa2_mask_bits = address ? mask_bits : 0;
+    dev->pointer = 0;
+    return I2C_SlaveRestart();
+}
+
+/**
+ * @brief Get the second own address
+ * @param mask_bits: Set to the low address bits ignored, may be NULL
+ * @return 7-bit address, 0 if OA2 is off
+ */
+uint8_t I2C_GetSecondAddress(uint8_t* mask_bits) {
+    if (mask_bits) {
+        *mask_bits = slave_oa2_mask_bits;
+    }
+    return slave_oa2_address;
+}
+
+/* The OA2 device's memory is only usable while it clears the OA1 device's */
+static bool I2C_SlaveDevOk(I2C_SlaveDev dev) {
+    return dev == I2C_SLAVE_DEV_OA1 ||
+           (dev == I2C_SLAVE_DEV_OA2 && slave_devs[I2C_SLAVE_DEV_OA1].size <= slave_devs[I2C_SLAVE_DEV_OA2].base);
+}
+
 /**
  * @brief Set a register value
- * @param reg_addr: Register address (0 or 1)
+ * @param dev: Device (OA1 or OA2)
+ * @param reg_addr: Register address, below the current map size
  * @param value: Value to set
  * @return HAL_StatusTypeDef
  */
-HAL_StatusTypeDef I2C_SetRegisterValue(uint8_t reg_addr, uint8_t value) {
-    if (reg_addr >= NUM_REGS) {
+HAL_StatusTypeDef I2C_SetRegisterValue(I2C_SlaveDev dev, uint16_t reg_addr, uint8_t value) {
+    if (!I2C_SlaveDevOk(dev) || reg_addr >= slave_devs[dev].size) {
         if(DEBUG_I2C) printf("Error: Invalid register address %d\n", reg_addr);
         return HAL_ERROR;
     }
 
-    slave_registers[reg_addr] = value;
+    slave_memory[slave_devs[dev].base + reg_addr] = value;
     if(DEBUG_I2C) printf("Register 0x%02X set to 0x%02X\n", reg_addr, value);
     return HAL_OK;
 }
 
 /**
  * @brief Get a register value
- * @param reg_addr: Register address (0 or 1)
+ * @param dev: Device (OA1 or OA2)
+ * @param reg_addr: Register address, below the current map size
  * @param value: Pointer to store the value
  * @return HAL_StatusTypeDef
  */
-HAL_StatusTypeDef I2C_GetRegisterValue(uint8_t reg_addr, uint8_t* value) {
-    if (reg_addr >= NUM_REGS || value == NULL) {
+HAL_StatusTypeDef I2C_GetRegisterValue(I2C_SlaveDev dev, uint16_t reg_addr, uint8_t* value) {
+    if (!I2C_SlaveDevOk(dev) || reg_addr >= slave_devs[dev].size || value == NULL) {
         if(DEBUG_I2C) printf("Error: Invalid register address or NULL pointer\n");
         return HAL_ERROR;
     }
 
-    *value = slave_registers[reg_addr];
+    *value = slave_memory[slave_devs[dev].base + reg_addr];
     return HAL_OK;
 }
 
+/**
+ * @brief Give a device a new layout and restart the slave
+ * @param dev: Device to change
+ * @param size: Map or EEPROM size
+ * @param eeprom: EEPROM geometry, NULL for register mode
+ * @return HAL_StatusTypeDef
+ */
+static HAL_StatusTypeDef I2C_SlaveConfigure(I2C_SlaveDev dev, uint16_t size, const I2C_EepromConfig* eeprom) {
+    if (dev >= I2C_SLAVE_DEV_COUNT || !I2C_SlaveLayoutOk(dev, size, eeprom, I2C_SlaveBanks(dev))) {
+        if(DEBUG_I2C) printf("Error: Invalid slave map layout\n");
+        return HAL_ERROR;
+    }
+
+    // Restart the slave so no burst is running against the old layout
+    slave_devs[dev].size = size;
+    if (eeprom) {
+        slave_devs[dev].eeprom = *eeprom;
+    } else {
+        memset(&slave_devs[dev].eeprom, 0, sizeof(slave_devs[dev].eeprom));
+    }
+    slave_devs[dev].pointer = 0;
+    slave_devs[dev].writes = 0;
+    slave_devs[I2C_SLAVE_DEV_OA2].base = I2C_SLAVE_MEM_SIZE - slave_devs[I2C_SLAVE_DEV_OA2].size;
+    return I2C_SlaveRestart();
+}
+
+/**
+ * @brief Change the size of a device's register map
+ * @param dev: Device (OA1 or OA2)
+ * @param size: 1 to I2C_REG_FILE_MAX bytes per bank
+ * @return HAL_StatusTypeDef
+ */
+HAL_StatusTypeDef I2C_SetRegisterFileSize(I2C_SlaveDev dev, uint16_t size) {
+    return I2C_SlaveConfigure(dev, size, NULL);
+}
+
+uint16_t I2C_GetRegisterFileSize(I2C_SlaveDev dev) {
+    return dev < I2C_SLAVE_DEV_COUNT ? slave_devs[dev].size : 0;
+}
+
+/**
+ * @brief Copy bytes into a device's register map
+ * @param dev: Device (OA1 or OA2)
+ * @param start: First register
+ * @param data: Values to store
+ * @param length: Number of bytes
+ * @return HAL_StatusTypeDef
+ */
+HAL_StatusTypeDef I2C_LoadRegisters(I2C_SlaveDev dev, uint16_t start, const uint8_t* data, uint16_t length) {
+    if (!I2C_SlaveDevOk(dev) || data == NULL || start >= slave_devs[dev].size ||
+        length > slave_devs[dev].size - start) {
+        return HAL_ERROR;
+    }
+
+    memcpy(&slave_memory[slave_devs[dev].base + start], data, length);
+    return HAL_OK;
+}
+
+/**
+ * @brief Print part of a device's register map as a hex string
+ * @param dev: Device (OA1 or OA2)
+ * @param buffer: Output buffer, 2 * length + 1 bytes
+ * @param start: First register
+ * @param length: Number of bytes
+ * @return HAL_StatusTypeDef
+ */
+HAL_StatusTypeDef I2C_DumpRegisters(I2C_SlaveDev dev, char* buffer, uint16_t start, uint16_t length) {
+    static const char digits[] = "0123456789ABCDEF";
+
+    if (!I2C_SlaveDevOk(dev) || start >= slave_devs[dev].size || length > slave_devs[dev].size - start) {
+        return HAL_ERROR;
+    }
+
+    for (uint16_t i = 0; i < length; i++) {
+        uint8_t value = slave_memory[slave_devs[dev].base + start + i];
+        *buffer++ = digits[value >> 4];
+        *buffer++ = digits[value & 0x0F];
+    }
+    *buffer = '\0';
+    return HAL_OK;
+}
+
+/**
+ * @brief Make a device behave like a 24Cxx EEPROM, or go back to registers
+ * @param dev: Device (OA1 or OA2)
+ * @param config: Geometry and write cycle, NULL for register mode
+ * @return HAL_StatusTypeDef
+ */
+HAL_StatusTypeDef I2C_SetEepromMode(I2C_SlaveDev dev, const I2C_EepromConfig* config) {
+    if (config == NULL) {
+        return I2C_SlaveConfigure(dev, I2C_REG_FILE_SIZE * I2C_SlaveBanks(dev), NULL);
+    }
+    return I2C_SlaveConfigure(dev, config->size, config);
+}
+
+/**
+ * @brief Print a device's EEPROM mode settings and write count
+ * @param dev: Device (OA1 or OA2)
+ * @param buffer: Output buffer
+ */
+void I2C_PrintEepromStatus(I2C_SlaveDev dev, char* buffer) {
+    const I2C_SlaveDevice* d = &slave_devs[dev];
+
+    if (d->eeprom.size == 0) {
+        sprintf(buffer, "OFF map=%u", d->size);
+        return;
+    }
+    sprintf(buffer, "size=%u addr_bytes=%u page=%u write_ms=%u busy=%u writes=%lu",
+            d->eeprom.size, d->eeprom.addr_bytes, d->eeprom.page, d->eeprom.write_ms,
+            d->busy ? 1 : 0, (unsigned long)d->writes);
+}
+
+/**
+ * @brief End EEPROM write cycles, called every 1 ms from SysTick
+ *
+ * The address comes back after more than write_ms, never early.
+ */
+void I2C_SlaveTick(void) {
+    I2C_SlaveDevice* d = &slave_devs[I2C_SLAVE_DEV_OA1];
+
+    if (d->busy && HAL_GetTick() - d->busy_ms > d->eeprom.write_ms) {
+        SET_BIT(hi2c1.Instance->OAR1, I2C_OAR1_OA1EN);
+        d->busy = false;
+    }
+    d = &slave_devs[I2C_SLAVE_DEV_OA2];
+    if (d->busy && HAL_GetTick() - d->busy_ms > d->eeprom.write_ms) {
+        SET_BIT(hi2c1.Instance->OAR2, I2C_OAR2_OA2EN);
+        d->busy = false;
+    }
+}
+
 /**
  * @brief Initialize I2C slave mode with register access
  * @param address: Initial slave address (7-bit, 0-127)
@@ -224,12 +943,12 @@ HAL_StatusTypeDef I2C_GetRegisterValue(uint8_t reg_addr, uint8_t* value) {
 HAL_StatusTypeDef I2C_SlaveInit(uint8_t address) {
     // Initialize I2C1 as slave with the provided address
     hi2c1.Instance = I2C1;
-    hi2c1.Init.Timing = 0x2000090E;
+    I2C_SlaveClockConfig();
     hi2c1.Init.OwnAddress1 = address << 1; // Shift left by 1 as per HAL requirement
     hi2c1.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
-    hi2c1.Init.DualAddressMode = I2C_DUALADDRESS_DISABLE;
-    hi2c1.Init.OwnAddress2 = 0;
-    hi2c1.Init.OwnAddress2Masks = I2C_OA2_NOMASK;
+    hi2c1.Init.DualAddressMode = slave_oa2_address ? I2C_DUALADDRESS_ENABLE : I2C_DUALADDRESS_DISABLE;
+    hi2c1.Init.OwnAddress2 = slave_oa2_address << 1;
+    hi2c1.Init.OwnAddress2Masks = slave_oa2_mask_bits;
     hi2c1.Init.GeneralCallMode = I2C_GENERALCALL_DISABLE;
     hi2c1.Init.NoStretchMode = I2C_NOSTRETCH_DISABLE;
 
@@ -250,6 +969,10 @@ HAL_StatusTypeDef I2C_SlaveInit(uint8_t address) {
         return HAL_ERROR;
     }
 
+    // The listen/receive/transmit calls below are interrupt driven
+    HAL_NVIC_SetPriority(I2C1_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(I2C1_IRQn);
+
     // Start listening for address match
     slave_state = I2C_SLAVE_IDLE;
     if (HAL_I2C_EnableListen_IT(&hi2c1) != HAL_OK) {
@@ -265,11 +988,23 @@ HAL_StatusTypeDef I2C_SlaveInit(uint8_t address) {
  * @brief Print the current status of I2C slave registers
  */
 void I2C_PrintSlaveStatus(void) {
+    static const char* const names[I2C_SLAVE_DEV_COUNT] = { "OA1", "OA2" };
+
     printf("\nI2C Slave Status:\n");
     printf("---------------------------\n");
     printf("Address: 0x%02X\n", (uint8_t)(hi2c1.Init.OwnAddress1 >> 1));
-    printf("Register 0 (0x00): 0x%02X\n", slave_registers[0]);
-    printf("Register 1 (0x01): 0x%02X\n", slave_registers[1]);
+    if (slave_oa2_address) {
+        printf("Address 2: 0x%02X-0x%02X\n", slave_oa2_address,
+               slave_oa2_address + (1U << slave_oa2_mask_bits) - 1);
+    } else {
+        printf("Address 2: OFF\n");
+    }
+    for (int i = 0; i < I2C_SLAVE_DEV_COUNT; i++) {
+        printf("%s: %s, size %u, pointer 0x%02X\n", names[i],
+               slave_devs[i].eeprom.size ? "EEPROM" : "REGISTERS", slave_devs[i].size, slave_devs[i].pointer);
+    }
+    printf("Bytes written: %lu\n", (unsigned long)slave_rx_bytes);
+    printf("Bytes read: %lu\n", (unsigned long)slave_tx_bytes);
     printf("Current state: ");
 
     switch(slave_state) {
@@ -291,6 +1026,186 @@ void I2C_PrintSlaveStatus(void) {
     printf("---------------------------\n");
 }
 
+/**
+ * @brief Record the transaction in progress and return to idle
+ * @param error: HAL_I2C_ERROR_* bits, 0 for a normal end
+ *
+ * Runs only from the I2C1 interrupt, the single producer of the ring.
+ */
+static void I2C_SlaveLog(uint32_t error) {
+    if (slave_state != I2C_SLAVE_IDLE) {
+        uint16_t next = (slave_log_head + 1) % I2C_SLAVE_LOG_SIZE;
+        slave_xfers++;
+        if (next == slave_log_tail) {
+            slave_log_overflows++;
+        } else {
+            I2C_SlaveLogEntry* entry = &slave_log[slave_log_head];
+            entry->timestamp_us = slave_xfer_us;
+            entry->address = slave_xfer_addr;
+            entry->read = (slave_state == I2C_SLAVE_REG_READ);
+            entry->reg = slave_win_base + slave_burst_reg;
+            entry->bytes = (uint16_t)slave_burst_bytes;
+            entry->error = (uint8_t)error;
+            entry->stretch_us = slave_xfer_stretch_us;
+            entry->nacked = slave_nacked;
+            slave_log_head = next;
+        }
+    }
+    slave_state = I2C_SLAVE_IDLE;
+}
+
+/**
+ * @brief Commit an EEPROM page write and start the write cycle
+ * @param page_base: Bank offset of the first byte of the page
+ * @param offset: Page offset of the first byte written
+ * @param count: Bytes written, at most one page
+ */
+static void I2C_EepromCommit(uint16_t page_base, uint16_t offset, uint16_t count) {
+    uint8_t* bank = slave_memory + slave_dev->base + slave_win_base;
+
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t pos = (offset + i) % slave_dev->eeprom.page;
+        bank[page_base + pos] = eeprom_page[pos];
+    }
+    slave_dev->writes++;
+
+    if (slave_dev->eeprom.write_ms) {
+        // Not matching the own address is a NACK to the master's polling
+        if (slave_dev == &slave_devs[I2C_SLAVE_DEV_OA1]) {
+            CLEAR_BIT(hi2c1.Instance->OAR1, I2C_OAR1_OA1EN);
+        } else {
+            CLEAR_BIT(hi2c1.Instance->OAR2, I2C_OAR2_OA2EN);
+        }
+        slave_dev->busy_ms = HAL_GetTick();
+        slave_dev->busy = true;
+    }
+}
+
+/**
+ * @brief Close a data burst: move the pointer past what the master transferred
+ * @param hi2c Pointer to I2C handle
+ * @param stop: The burst ended with STOP, so an EEPROM page write is committed
+ */
+static void I2C_SlaveBurstEnd(I2C_HandleTypeDef *hi2c, bool stop) {
+    // After an injected NACK the HAL buffer is slave_discard, count up to the NACKed byte
+    uint8_t* end = slave_nacked ? slave_nack_ptr : hi2c->pBuffPtr;
+    int32_t moved = (end - slave_seg_base) - slave_seg_pos;
+    uint16_t pointer;
+
+    if (slave_state == I2C_SLAVE_REG_READ) {
+        // The last byte loaded was never acknowledged. If that was the final
+        // byte before a wrap, moved is -1 and the wrap already counted it.
+        moved--;
+        slave_tx_bytes += moved;
+    } else {
+        slave_rx_bytes += moved;
+    }
+    slave_burst_bytes += moved;
+
+    if (slave_state == I2C_SLAVE_REG_WRITE && slave_dev->eeprom.size) {
+        uint16_t offset = slave_burst_reg % slave_dev->eeprom.page;
+        uint16_t page_base = slave_burst_reg - offset;
+
+        if (stop && slave_burst_bytes > 0) {
+            I2C_EepromCommit(page_base, offset, slave_burst_bytes < slave_dev->eeprom.page ?
+                             slave_burst_bytes : slave_dev->eeprom.page);
+        }
+        pointer = page_base + (offset + slave_burst_bytes) % slave_dev->eeprom.page;
+    } else {
+        pointer = (slave_burst_reg + slave_burst_bytes) % slave_win_size;
+    }
+    slave_dev->pointer = slave_win_base + pointer;
+    I2C_SlaveLog(0);
+}
+
+/**
+ * @brief Receive up to count bytes, stopping short of the byte picked for an injected NACK
+ * @param hi2c Pointer to I2C handle
+ * @param buf: Where the bytes go
+ * @param count: Bytes to the end of the buffer
+ *
+ * Once the NACK point is reached every further byte is NACKed into slave_discard.
+ */
+static void I2C_SlaveReceive(I2C_HandleTypeDef *hi2c, uint8_t* buf, uint16_t count) {
+    if (slave_nack_left == 0) {
+        slave_nack_left = -1;
+        slave_nacked = true;
+        slave_nack_ptr = buf;
+    }
+    if (slave_nacked) {
+        buf = &slave_discard;
+        count = 1;
+    } else if (slave_nack_left > 0 && slave_nack_left < count) {
+        count = (uint16_t)slave_nack_left;
+    }
+
+    slave_rx_armed = count;
+    HAL_I2C_Slave_Seq_Receive_IT(hi2c, buf, count,
+                                 slave_state == I2C_SLAVE_REG_ADDR ? I2C_FIRST_FRAME : I2C_LAST_FRAME);
+    if (slave_nacked) {
+        // The HAL call clears NACK, set it for the byte now being clocked in
+        SET_BIT(hi2c->Instance->CR2, I2C_CR2_NACK);
+    }
+}
+
+/**
+ * @brief Start moving data bytes from the pointer on
+ * @param hi2c Pointer to I2C handle
+ * @param read: Master reads (transmit) rather than writes (receive)
+ * @param pointer: Bank offset of the first byte
+ */
+static void I2C_SlaveBurstStart(I2C_HandleTypeDef *hi2c, bool read, uint16_t pointer) {
+    slave_burst_reg = pointer;
+    slave_burst_bytes = 0;
+
+    if (!read && slave_dev->eeprom.size) {
+        // Page write, rolls over within the page
+        slave_seg_base = eeprom_page;
+        slave_seg_span = slave_dev->eeprom.page;
+        slave_seg_pos = pointer % slave_dev->eeprom.page;
+    } else {
+        slave_seg_base = slave_memory + slave_dev->base + slave_win_base;
+        slave_seg_span = slave_win_size;
+        slave_seg_pos = pointer;
+    }
+
+    if (read) {
+        slave_state = I2C_SLAVE_REG_READ;
+        HAL_I2C_Slave_Seq_Transmit_IT(hi2c, slave_seg_base + slave_seg_pos,
+                                      slave_seg_span - slave_seg_pos, I2C_NEXT_FRAME);
+    } else {
+        slave_state = I2C_SLAVE_REG_WRITE;
+        I2C_SlaveReceive(hi2c, slave_seg_base + slave_seg_pos, slave_seg_span - slave_seg_pos);
+    }
+}
+
+/**
+ * @brief The burst reached the end of its buffer, carry on from the start
+ * @return Bytes moved in the segment that just finished
+ */
+static uint16_t I2C_SlaveBurstWrap(void) {
+    uint16_t moved = slave_seg_span - slave_seg_pos;
+
+    slave_burst_bytes += moved;
+    slave_seg_pos = 0;
+    return moved;
+}
+
+/**
+ * @brief Start the transfer for the address just matched, which clears ADDR and releases SCL
+ * @param hi2c Pointer to I2C handle
+ */
+static void I2C_SlaveAddrRelease(I2C_HandleTypeDef *hi2c) {
+    if (slave_xfer_read) {
+        // Master is reading from the pointer on
+        I2C_SlaveBurstStart(hi2c, true, slave_burst_reg);
+    } else {
+        // Master is writing to slave - expect register pointer first
+        slave_state = I2C_SLAVE_REG_ADDR;
+        I2C_SlaveReceive(hi2c, rx_buffer, slave_dev->eeprom.size ? slave_dev->eeprom.addr_bytes : 1);
+    }
+}
+
 /**
  * @brief Callback when address match event occurs
  * @param hi2c Pointer to I2C handle
@@ -299,26 +1214,67 @@ void I2C_PrintSlaveStatus(void) {
  */
 void HAL_I2C_AddrCallback(I2C_HandleTypeDef *hi2c, uint8_t TransferDirection, uint16_t AddrMatchCode) {
     if (hi2c->Instance == I2C1) {
-        if (TransferDirection == I2C_DIRECTION_TRANSMIT) {
-            // Master is writing to slave - expect register address first
-            slave_state = I2C_SLAVE_REG_ADDR;
-            HAL_I2C_Slave_Seq_Receive_IT(hi2c, rx_buffer, 1, I2C_FIRST_FRAME);
+        // A repeated start ends the burst in progress
+        if (slave_state == I2C_SLAVE_REG_READ || slave_state == I2C_SLAVE_REG_WRITE) {
+            I2C_SlaveBurstEnd(hi2c, false);
         } else {
-            // Master is reading from slave - send current register value
-            if (slave_state == I2C_SLAVE_REG_ADDR) {
-                // If we already have a register address, use it
-                slave_state = I2C_SLAVE_REG_READ;
-                HAL_I2C_Slave_Seq_Transmit_IT(hi2c, &slave_registers[current_reg_addr], 1, I2C_LAST_FRAME);
-            } else {
-                // Otherwise use register 0 as default
-                slave_state = I2C_SLAVE_REG_READ;
-                current_reg_addr = 0;
-                HAL_I2C_Slave_Seq_Transmit_IT(hi2c, &slave_registers[0], 1, I2C_LAST_FRAME);
+            I2C_SlaveLog(0);
+        }
+        slave_xfer_us = micros();
+        slave_xfer_addr = (uint8_t)(AddrMatchCode >> 1);
+
+        // OA1 wins if it also falls in the OA2 range; the OA2 don't-care bits pick the bank
+        if (AddrMatchCode == (hi2c->Init.OwnAddress1 & 0xFE)) {
+            slave_dev = &slave_devs[I2C_SLAVE_DEV_OA1];
+            slave_win_size = slave_dev->size;
+            slave_win_base = 0;
+        } else {
+            slave_dev = &slave_devs[I2C_SLAVE_DEV_OA2];
+            slave_win_size = slave_dev->size >> slave_oa2_mask_bits;
+            slave_win_base = (slave_xfer_addr & ((1U << slave_oa2_mask_bits) - 1)) * slave_win_size;
+        }
+        slave_burst_reg = slave_dev->pointer % slave_win_size;
+        slave_burst_bytes = 0;
+
+        slave_xfer_read = (TransferDirection != I2C_DIRECTION_TRANSMIT);
+        slave_xfer_stretch_us = 0;
+        slave_nacked = false;
+        slave_nack_left = (!slave_xfer_read && slave_inject.nack_byte != I2C_INJECT_NACK_OFF) ?
+                          slave_inject.nack_byte : -1;
+
+        if (slave_inject.stretch_us == 0 ||
+            !(slave_xfer_read ? slave_inject.stretch_read : slave_inject.stretch_write)) {
+            I2C_SlaveAddrRelease(hi2c);
+        } else if (slave_inject.stretch_us <= I2C_INJECT_SPIN_US) {
+            while (micros() - slave_xfer_us < slave_inject.stretch_us) {
             }
+            slave_xfer_stretch_us = micros() - slave_xfer_us;
+            I2C_SlaveAddrRelease(hi2c);
+        } else {
+            // Returning with ADDR still set keeps SCL low until TIM2 CC3
+            slave_stretching = true;
+            TIM2->CCR3 = slave_xfer_us + slave_inject.stretch_us;
+            TIM2->SR = ~TIM_SR_CC3IF;
+            TIM2->DIER |= TIM_DIER_CC3IE;
         }
     }
 }
 
+/**
+ * @brief End an injected stretch, called from the TIM2 CC3 interrupt
+ */
+void I2C_SlaveStretchEnd(void) {
+    if (!slave_stretching) {
+        return;
+    }
+    TIM2->DIER &= ~TIM_DIER_CC3IE;
+    slave_stretching = false;
+
+    uint32_t held = micros() - slave_xfer_us;
+    slave_xfer_stretch_us = held > 0xFFFF ? 0xFFFF : (uint16_t)held;
+    I2C_SlaveAddrRelease(&hi2c1);
+}
+
 
 /**
  * @brief Callback when data is received
@@ -326,53 +1282,65 @@ void HAL_I2C_AddrCallback(I2C_HandleTypeDef *hi2c, uint8_t TransferDirection, ui
  */
 void HAL_I2C_SlaveRxCpltCallback(I2C_HandleTypeDef *hi2c) {
     if (hi2c->Instance == I2C1) {
-        if (slave_state == I2C_SLAVE_REG_ADDR) {
-            // We received the register address
-            current_reg_addr = rx_buffer[0];
+        uint16_t addr_len = slave_dev->eeprom.size ? slave_dev->eeprom.addr_bytes : 1;
 
-            // Validate register address
-            if (current_reg_addr >= NUM_REGS) {
-                current_reg_addr = 0; // Default to register 0 if invalid
+        if (slave_nack_left > 0) {
+            slave_nack_left -= slave_rx_armed;
+        }
+
+        if (slave_nacked) {
+            // The master carried on after the injected NACK, keep refusing
+            I2C_SlaveReceive(hi2c, &slave_discard, 1);
+        }
+        else if (slave_state == I2C_SLAVE_REG_ADDR && hi2c->pBuffPtr != rx_buffer + addr_len) {
+            // Stopped inside a 2-byte word address for an injected NACK
+            I2C_SlaveReceive(hi2c, hi2c->pBuffPtr, rx_buffer + addr_len - hi2c->pBuffPtr);
+        }
+        else if (slave_state == I2C_SLAVE_REG_ADDR) {
+            // We received the register pointer
+            uint16_t pointer = rx_buffer[0];
+
+            if (slave_dev->eeprom.size) {
+                // Word address bits above the bank size are ignored, as on the real part
+                if (slave_dev->eeprom.addr_bytes == 2) {
+                    pointer = (pointer << 8) | rx_buffer[1];
+                }
+                pointer %= slave_win_size;
+            } else if (pointer >= slave_win_size) {
+                pointer = 0; // Default to register 0 if invalid
             }
 
-            // Now ready to receive data for this register
-            slave_state = I2C_SLAVE_REG_WRITE;
-            HAL_I2C_Slave_Seq_Receive_IT(hi2c, rx_buffer, 1, I2C_LAST_FRAME);
+            // Data bytes go straight into the buffer until STOP
+            I2C_SlaveBurstStart(hi2c, false, pointer);
         }
         else if (slave_state == I2C_SLAVE_REG_WRITE) {
-            // We received data to write to the register
-            slave_registers[current_reg_addr] = rx_buffer[0];
+            uint8_t* next = hi2c->pBuffPtr;
 
-            if (DEBUG_I2C) printf("I2C Slave: Register 0x%02X written with value 0x%02X\n",
-                                current_reg_addr, slave_registers[current_reg_addr]);
-
-            // Reset state machine
-            slave_state = I2C_SLAVE_IDLE;
-            HAL_I2C_EnableListen_IT(hi2c);
+            if (next == slave_seg_base + slave_seg_span) {
+                // Written up to the end of the map or page, wrap to its start
+                slave_rx_bytes += I2C_SlaveBurstWrap();
+                next = slave_seg_base;
+            }
+            // Otherwise the receive stopped short for an injected NACK, carry on in place
+            I2C_SlaveReceive(hi2c, next, slave_seg_base + slave_seg_span - next);
         }
     }
 }
 
-/*
-// Callback when Master reads data from the Slave
-void HAL_I2C_SlaveTxCpltCallback(I2C_HandleTypeDef *hi2c) {
-    // Restart transmission if needed
-    HAL_I2C_Slave_Transmit_IT(&hi2c1, i2c_tx_buffer, sizeof(i2c_tx_buffer));
-}
-*/
-
 /**
  * @brief Callback when data is transmitted
  * @param hi2c Pointer to I2C handle
  */
 void HAL_I2C_SlaveTxCpltCallback(I2C_HandleTypeDef *hi2c) {
     if (hi2c->Instance == I2C1) {
-        // Transmission complete, reset state
-        slave_state = I2C_SLAVE_IDLE;
-        HAL_I2C_EnableListen_IT(hi2c);
-
-        if (DEBUG_I2C) printf("I2C Slave: Register 0x%02X read, value 0x%02X\n",
-                            current_reg_addr, slave_registers[current_reg_addr]);
+        if (slave_state == I2C_SLAVE_REG_READ) {
+            // Read up to the end of the map, wrap to address 0
+            slave_tx_bytes += I2C_SlaveBurstWrap();
+            HAL_I2C_Slave_Seq_Transmit_IT(hi2c, slave_seg_base, slave_seg_span, I2C_NEXT_FRAME);
+        } else {
+            I2C_SlaveLog(0);
+            HAL_I2C_EnableListen_IT(hi2c);
+        }
     }
 }
 
@@ -383,7 +1351,11 @@ void HAL_I2C_SlaveTxCpltCallback(I2C_HandleTypeDef *hi2c) {
 void HAL_I2C_ListenCpltCallback(I2C_HandleTypeDef *hi2c) {
     if (hi2c->Instance == I2C1) {
         // Transaction completed (STOP condition), restart listening
-        slave_state = I2C_SLAVE_IDLE;
+        if (slave_state == I2C_SLAVE_REG_READ || slave_state == I2C_SLAVE_REG_WRITE) {
+            I2C_SlaveBurstEnd(hi2c, true);
+        } else {
+            I2C_SlaveLog(0);
+        }
         HAL_I2C_EnableListen_IT(hi2c);
     }
 }
@@ -403,47 +1375,315 @@ void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
  * @param hi2c Pointer to I2C handle
  */
 void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
+    uint32_t error = HAL_I2C_GetError(hi2c);
+
+    if (hi2c->Instance == I2C2) {
+        I2C_CountErrors(&i2c_stats[I2C_BUS_MASTER], error);
+        // A NACK ends cleanly with a STOP; anything else may leave the bus held
+        if (error & (HAL_I2C_ERROR_BERR | HAL_I2C_ERROR_ARLO)) {
+            master_recover = I2C_RECOVER_PENDING;
+        }
+        if (master_active) {
+            I2C_MasterFinish(HAL_ERROR);
+            I2C_MasterStartNext();
+        }
+        return;
+    }
     if (hi2c->Instance == I2C1) {
-        // Reset and restart on error
-        slave_state = I2C_SLAVE_IDLE;
-        HAL_I2C_DeInit(hi2c);
-        HAL_I2C_Init(hi2c);
-        HAL_I2C_EnableListen_IT(hi2c);
+        if (error == HAL_I2C_ERROR_AF) {
+            // Master ended the burst (NACK on read, STOP on write) before the end of the map
+            if (slave_state == I2C_SLAVE_REG_READ || slave_state == I2C_SLAVE_REG_WRITE) {
+                I2C_SlaveBurstEnd(hi2c, true);
+            } else {
+                I2C_SlaveLog(0);
+            }
+            HAL_I2C_EnableListen_IT(hi2c);
+            return;
+        }
 
-        if (DEBUG_I2C) printf("I2C Slave: Error occurred, restarting\n");
+        I2C_CountErrors(&i2c_stats[I2C_BUS_SLAVE], error);
+        I2C_SlaveLog(error);
+        if (error & (HAL_I2C_ERROR_BERR | HAL_I2C_ERROR_ARLO | HAL_I2C_ERROR_OVR)) {
+            // Clearing PE releases SCL/SDA at once; the re-init runs from I2C_Process()
+            CLEAR_BIT(hi2c->Instance->CR1, I2C_CR1_PE);
+            slave_reset_pending = true;
+        } else {
+            HAL_I2C_EnableListen_IT(hi2c);
+        }
     }
 }
 
+static void I2C_BenchProcess(void);
 
+/**
+ * @brief Finish deferred slave recovery and advance I2C_BENCH, called from the main loop
+ */
+void I2C_Process(void) {
+    if (slave_reset_pending) {
+        slave_reset_pending = false;
+        i2c_stats[I2C_BUS_SLAVE].recoveries++;
+        HAL_I2C_DeInit(&hi2c1);
+        I2C_SlaveStretchCancel();
+        I2C_SlaveInit((uint8_t)(hi2c1.Init.OwnAddress1 >> 1));
+    }
+    I2C_BenchProcess();
+}
 
+/**
+ * @brief Print per-bus error counters
+ * @param buffer: Output buffer
+ */
+void I2C_PrintStats(char *buffer) {
+    static const char* const names[I2C_BUS_COUNT] = { "I2C1_SLAVE", "I2C2_PCA" };
+
+    sprintf(tStr, "%-10s | %-6s | %-6s | %-6s | %-6s | %-7s | %s\n",
+            "BUS", "NACK", "ARLO", "BERR", "OVR", "TIMEOUT", "RECOVER");
+    strcat(buffer, tStr);
+    strcat(buffer, "--------------------------------------------------------------\n");
+    for (int i = 0; i < I2C_BUS_COUNT; i++) {
+        sprintf(tStr, "%-10s | %-6lu | %-6lu | %-6lu | %-6lu | %-7lu | %lu\n", names[i],
+                (unsigned long)i2c_stats[i].nack, (unsigned long)i2c_stats[i].arbitration,
+                (unsigned long)i2c_stats[i].bus_error, (unsigned long)i2c_stats[i].overrun,
+                (unsigned long)i2c_stats[i].timeout, (unsigned long)i2c_stats[i].recoveries);
+        strcat(buffer, tStr);
+    }
+    // Sequencer output writes to the PCA9534 that were not acknowledged
+    sprintf(tStr, "PCA9534 async write errors: %lu\n", (unsigned long)hPCA.TxErrors);
+    strcat(buffer, tStr);
+}
 
+void I2C_ClearStats(void) {
+    __disable_irq();
+    memset((void*)i2c_stats, 0, sizeof(i2c_stats));
+    hPCA.TxErrors = 0;
+    __enable_irq();
+}
 
+static bool I2C_PopSlaveLog(I2C_SlaveLogEntry* entry) {
+    if (slave_log_tail == slave_log_head) {
+        return false;
+    }
+    *entry = slave_log[slave_log_tail];
+    slave_log_tail = (slave_log_tail + 1) % I2C_SLAVE_LOG_SIZE;
+    return true;
+}
 
+/**
+ * @brief Drain the slave transaction log into buffer, one line per transaction
+ * @param buffer: Output buffer
+ */
+void I2C_PrintSlaveLog(char* buffer) {
+    I2C_SlaveLogEntry entry;
+
+    while (I2C_PopSlaveLog(&entry)) {
+        sprintf(tStr, "%lu 0x%02X %s reg=0x%02X bytes=%u", (unsigned long)entry.timestamp_us,
+                entry.address, entry.read ? "R" : "W", entry.reg, entry.bytes);
+        strcat(buffer, tStr);
+        if (entry.stretch_us) {
+            sprintf(tStr, " stretch_us=%u", entry.stretch_us);
+            strcat(buffer, tStr);
+        }
+        if (entry.nacked) {
+            strcat(buffer, " NACK");
+        }
+        if (entry.error) {
+            sprintf(tStr, " ERR 0x%02X\n", entry.error);
+        } else {
+            strcpy(tStr, " OK\n");
+        }
+        strcat(buffer, tStr);
+    }
+    if (slave_log_overflows) {
+        sprintf(tStr, "OVERFLOW %lu\n", (unsigned long)slave_log_overflows);
+        strcat(buffer, tStr);
+        slave_log_overflows = 0;
+    }
+}
 
+/**
+ * @brief Discard logged slave transactions
+ */
+void I2C_ClearSlaveLog(void) {
+    slave_log_tail = slave_log_head;
+    slave_log_overflows = 0;
+}
 
+/**
+ * @brief Set clock-stretch and NACK injection on the I2C1 slave
+ * @param inject: Settings, NULL to turn injection off
+ * @return HAL_OK, or HAL_ERROR on a stretch that is too long or has no direction
+ */
+HAL_StatusTypeDef I2C_SetSlaveInject(const I2C_SlaveInject* inject) {
+    static const I2C_SlaveInject off = { .nack_byte = I2C_INJECT_NACK_OFF };
 
+    if (inject == NULL) {
+        inject = &off;
+    }
+    if (inject->stretch_us > I2C_INJECT_MAX_STRETCH_US ||
+        (inject->stretch_us && !inject->stretch_read && !inject->stretch_write)) {
+        if(DEBUG_I2C) printf("Error: Invalid stretch injection\n");
+        return HAL_ERROR;
+    }
 
+    __disable_irq();
+    slave_inject = *inject;
+    __enable_irq();
 
+    if (inject->stretch_us > I2C_INJECT_SPIN_US) {
+        // Long stretches are released from the TIM2 CC3 interrupt
+        HAL_NVIC_SetPriority(TIM2_IRQn, 0, 0);
+        HAL_NVIC_EnableIRQ(TIM2_IRQn);
+    }
+    return HAL_OK;
+}
 
+/**
+ * @brief Print the injection settings
+ * @param buffer: Output buffer
+ */
+void I2C_PrintSlaveInject(char* buffer) {
+    if (slave_inject.stretch_us == 0 && slave_inject.nack_byte == I2C_INJECT_NACK_OFF) {
+        strcat(buffer, "OFF");
+        return;
+    }
 
+    if (slave_inject.stretch_us) {
+        sprintf(tStr, "stretch_us=%lu %s%s", (unsigned long)slave_inject.stretch_us,
+                slave_inject.stretch_read ? "R" : "", slave_inject.stretch_write ? "W" : "");
+    } else {
+        strcpy(tStr, "stretch_us=0");
+    }
+    strcat(buffer, tStr);
+    if (slave_inject.nack_byte != I2C_INJECT_NACK_OFF) {
+        sprintf(tStr, " nack=%u", slave_inject.nack_byte);
+    } else {
+        strcpy(tStr, " nack=OFF");
+    }
+    strcat(buffer, tStr);
+}
 
+/**
+ * @brief Set the bus speed the I2C1 slave is timed for
+ * @param khz: 100, 400 or 1000
+ * @return HAL_OK, or HAL_ERROR for an unsupported speed
+ */
+HAL_StatusTypeDef I2C_SlaveSetSpeed(uint32_t khz) {
+    if (I2C_MasterTiming(khz) == 0) {
+        return HAL_ERROR;
+    }
+    slave_speed_khz = khz;
+    if(DEBUG_I2C) printf("I2C1 slave speed set to %lu kHz\n", (unsigned long)khz);
+    return I2C_SlaveRestart();
+}
 
+uint32_t I2C_SlaveGetSpeed(void) {
+    return slave_speed_khz;
+}
 
+// Slave counters at one instant, for I2C_SlaveBenchStart
+typedef struct {
+    uint32_t ms;
+    uint32_t rx_bytes;
+    uint32_t tx_bytes;
+    uint32_t xfers;
+    uint32_t errors;
+    uint32_t irq_cycles;
+} I2C_BenchSample;
+
+// Benchmark in progress, advanced by I2C_Process()
+static struct {
+    bool running;
+    uint32_t seconds;           // Requested duration
+    uint32_t done;              // Seconds reported so far
+    I2C_BenchSample first;
+    I2C_BenchSample last;
+} i2c_bench;
+
+static void I2C_BenchTake(I2C_BenchSample* sample) {
+    volatile I2C_BusStats* stats = &i2c_stats[I2C_BUS_SLAVE];
+
+    __disable_irq();
+    sample->ms = HAL_GetTick();
+    sample->rx_bytes = slave_rx_bytes;
+    sample->tx_bytes = slave_tx_bytes;
+    sample->xfers = slave_xfers;
+    sample->errors = stats->nack + stats->arbitration + stats->bus_error + stats->overrun;
+    sample->irq_cycles = i2c1_irq_cycles;
+    __enable_irq();
+}
 
+/*
+ * One line of per-second rates between two samples. bus is the share of the
+ * bus bit rate used by address and data bytes (9 clocks each), irq the share
+ * of CPU time spent in the I2C1 interrupt; when irq nears 100 % the tester is
+ * stretching SCL because it cannot keep up.
+ */
+static void I2C_BenchLine(char* buffer, const char* label, const I2C_BenchSample* from,
+                          const I2C_BenchSample* to) {
+    uint32_t ms = to->ms - from->ms;
+    uint32_t rx = to->rx_bytes - from->rx_bytes;
+    uint32_t tx = to->tx_bytes - from->tx_bytes;
+    uint32_t xfers = to->xfers - from->xfers;
+    uint32_t errors = to->errors - from->errors;
+    uint64_t bus;
+    uint64_t irq;
+
+    if (ms == 0) {
+        return;
+    }
+    // Both in 0.1 %: bits over khz * ms, cycles over HCLK cycles per ms * ms
+    bus = (uint64_t)(rx + tx + xfers) * 9 * 1000U / ((uint64_t)slave_speed_khz * ms);
+    irq = (uint64_t)(to->irq_cycles - from->irq_cycles) * 1000 / ((uint64_t)(SystemCoreClock / 1000) * ms);
+    sprintf(tStr, "%s wr_Bps=%lu rd_Bps=%lu xfers_ps=%lu err_ps=%lu bus=%u.%u%% irq=%u.%u%%\n", label,
+            (unsigned long)((uint64_t)rx * 1000 / ms), (unsigned long)((uint64_t)tx * 1000 / ms),
+            (unsigned long)((uint64_t)xfers * 1000 / ms), (unsigned long)((uint64_t)errors * 1000 / ms),
+            (unsigned)(bus / 10), (unsigned)(bus % 10), (unsigned)(irq / 10), (unsigned)(irq % 10));
+    strcat(buffer, tStr);
+}
 
+HAL_StatusTypeDef I2C_SlaveBenchStart(uint32_t seconds) {
+    if (i2c_bench.running) {
+        return HAL_BUSY;
+    }
+    if (seconds == 0 || seconds > I2C_BENCH_MAX_S) {
+        return HAL_ERROR;
+    }
 
+    I2C_BenchTake(&i2c_bench.first);
+    i2c_bench.last = i2c_bench.first;
+    i2c_bench.seconds = seconds;
+    i2c_bench.done = 0;
+    i2c_bench.running = true;
+    return HAL_OK;
+}
 
+/*
+ * Advance a running benchmark from I2C_Process(): one reply line per
+ * elapsed second, then the DONE line with the average.
+ */
+static void I2C_BenchProcess(void) {
+    I2C_BenchSample now;
+    char line[160];
+    char label[12];
 
+    if (!i2c_bench.running || HAL_GetTick() - i2c_bench.first.ms < (i2c_bench.done + 1) * 1000) {
+        return;
+    }
 
-
-
-
-
-
-
-
-
-
-
-
-
+    I2C_BenchTake(&now);
+    i2c_bench.done++;
+    line[0] = '\0';
+    sprintf(label, "%lus", (unsigned long)i2c_bench.done);
+    I2C_BenchLine(line, label, &i2c_bench.last, &now);
+    line[strcspn(line, "\n")] = '\0';
+    sendReply("I2C_BENCH", line);
+    i2c_bench.last = now;
+
+    if (i2c_bench.done >= i2c_bench.seconds) {
+        sprintf(line, "DONE speed=%lu kHz ", (unsigned long)slave_speed_khz);
+        I2C_BenchLine(line, "avg", &i2c_bench.first, &now);
+        line[strcspn(line, "\n")] = '\0';
+        sendReply("I2C_BENCH", line);
+        i2c_bench.running = false;
+    }
+}
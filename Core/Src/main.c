@@ -29,6 +29,10 @@
 #include "uart.h"
 #include "utils.h"
 #include "command.h"
+#include "powercycle.h"
+#include "settings.h"
+#include "profile.h"
+#include "measure.h"
 
 void SystemClock_Config(void);
 
@@ -41,6 +45,7 @@ int main(void)
 HAL_Init();
   /* Configure the system clock */
   SystemClock_Config();
+  Micros_Init();
 
   /* Initialize all configured peripherals */
   UART_Init();
@@ -73,6 +78,17 @@ HAL_Init();
       printf("USART1 is disabled\n");
   }
 
+  // Built-in model until a saved configuration says otherwise; keeps the boot defaults
+  PROFILE_Select(controllerType, false);
+
+  // A configuration stored with SAVE overrides the defaults above
+  uint32_t settings_seq;
+  SETTINGS_LoadResult settings_result = SETTINGS_Load(&settings_seq);
+  if (settings_result != SETTINGS_LOAD_NONE) {
+	  printf("Saved settings %lu applied%s\n", (unsigned long)settings_seq,
+	         settings_result == SETTINGS_LOAD_PARTIAL ? " with errors (PARTIAL)" : "");
+  }
+
 
   ADC_Init();
   int longer_count = 0;
@@ -88,6 +104,13 @@ HAL_Init();
   while (1)
   {
 	  handleSerialCommunications();
+	  GPIO_ProcessEvents();
+	  GPIO_ProcessWaits();
+	  GPIO_ProcessResponse();
+	  I2C_Process();
+	  CYCLE_Process();
+	  UART_BootProcess();
+	  MEASURE_Process();
 	  now_millis = millis();
 	  delay(10);
 	  if (now_millis - previous_millis >= 500) {
@@ -0,0 +1,307 @@
+/*
+ * measure.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: mavorpdx
+ *
+ * Frequency, duty-cycle and pulse-width measurement on P104 (PD2).
+ *
+ * PD2 has no timer capture channel on the F091, only TIM3_ETR, so the
+ * measurement is split in two:
+ *  - TIM3 counts rising edges on ETR in hardware (external clock mode 2)
+ *    over a micros() gate. This works up to fCK/4 = 12 MHz.
+ *  - Below MEASURE_EDGE_MAX_HZ both edges are also timestamped from EXTI2
+ *    against micros(), which gives the high/low widths, the duty cycle and
+ *    a reciprocal frequency (periods between first and last rising edge)
+ *    that is far finer than the gate count at low rates.
+ * A short count-only probe picks the method so a fast signal never floods
+ * the EXTI interrupt.
+ *
+ * MEASURE_Start opens the probe gate and returns; MEASURE_Process, called
+ * from the main loop, moves on to the main gate and sends the reply when
+ * it closes, so commands and serial bridging keep running meanwhile. The
+ * gates close on the first main-loop pass after they expire; the counts
+ * are taken over the actual gate time, which is what the rates use.
+ *
+ * Timestamps are taken at EXTI entry, so widths carry the interrupt
+ * latency difference between the two edges: a few us normally, more if a
+ * UART or SysTick interrupt was being serviced (all run at priority 0).
+ * Edges closer together than the handler can keep up with show up as
+ * "missed"; the frequency then falls back to the hardware count.
+ */
+#include <string.h>
+#include <stdio.h>
+
+#include "main.h"
+#include "measure.h"
+#include "command.h"
+
+typedef enum {
+    MEASURE_IDLE,
+    MEASURE_PROBE,      // Count-only gate that picks the method
+    MEASURE_GATE        // Main gate
+} MEASURE_State;
+
+// Edge timestamps collected from EXTI while the gate is open
+typedef struct {
+    bool open;                  // Gate is open, edges are recorded
+    bool synced;                // last_us/level hold a real edge
+    uint8_t level;              // Level after the last edge
+    uint32_t last_us;           // micros() of the last edge
+    uint32_t rises;
+    uint32_t first_rise_us;
+    uint32_t last_rise_us;
+    uint32_t missed;            // Edges with the same level twice in a row
+    MEASURE_Width high;
+    MEASURE_Width low;
+} MEASURE_Capture;
+
+static volatile MEASURE_Capture capture;
+static volatile uint32_t measure_overflows;    // TIM3 wraps in the gate
+static MEASURE_State measure_state = MEASURE_IDLE;
+static const GPIO_InputConfig* measure_pin;
+static uint32_t measure_window_ms;
+static uint32_t measure_gate_start;            // micros() when the current gate opened
+static MEASURE_Result measure_result;
+
+static void MEASURE_WidthAdd(volatile MEASURE_Width* width, uint32_t us) {
+    if (width->count == 0 || us < width->min_us) width->min_us = us;
+    if (width->count == 0 || us > width->max_us) width->max_us = us;
+    width->sum_us += us;
+    width->count++;
+}
+
+/* EXTI2 hook, runs on both edges of P104 */
+static void MEASURE_Edge(uint8_t level, uint32_t now_us) {
+    if (!capture.open) return;
+
+    if (capture.synced) {
+        if (level == capture.level) {
+            // The opposite edge was lost (or a runt pulse), restart the width here
+            capture.missed++;
+        } else if (level == 0) {
+            MEASURE_WidthAdd(&capture.high, now_us - capture.last_us);
+        } else {
+            MEASURE_WidthAdd(&capture.low, now_us - capture.last_us);
+        }
+    }
+
+    if (level && (!capture.synced || level != capture.level)) {
+        if (capture.rises == 0) capture.first_rise_us = now_us;
+        capture.last_rise_us = now_us;
+        capture.rises++;
+    }
+
+    capture.level = level;
+    capture.last_us = now_us;
+    capture.synced = true;
+}
+
+void TIM3_IRQHandler(void) {
+    if (TIM3->SR & TIM_SR_UIF) {
+        TIM3->SR = ~TIM_SR_UIF;
+        measure_overflows++;
+    }
+}
+
+/* Put P104 on TIM3_ETR (AF0) or back to a plain input */
+static void MEASURE_PinMode(const GPIO_InputConfig* pin, bool timer) {
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    GPIO_InitStruct.Pin = pin->GPIO_Pin;
+    GPIO_InitStruct.Mode = timer ? GPIO_MODE_AF_PP : GPIO_MODE_INPUT;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+    GPIO_InitStruct.Alternate = GPIO_AF0_TIM3;
+    HAL_GPIO_Init(pin->GPIOx, &GPIO_InitStruct);
+}
+
+/* TIM3 counts ETR rising edges, no filter or prescaler, 16-bit with wrap interrupt */
+static void MEASURE_TimerInit(void) {
+    __HAL_RCC_TIM3_CLK_ENABLE();
+    TIM3->CR1 = 0;
+    TIM3->PSC = 0;
+    TIM3->ARR = 0xFFFF;
+    TIM3->SMCR = TIM_SMCR_ECE;
+    TIM3->EGR = TIM_EGR_UG;
+    TIM3->SR = 0;
+    TIM3->DIER = TIM_DIER_UIE;
+
+    HAL_NVIC_SetPriority(TIM3_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(TIM3_IRQn);
+}
+
+static void MEASURE_TimerStop(void) {
+    TIM3->CR1 = 0;
+    TIM3->DIER = 0;
+    HAL_NVIC_DisableIRQ(TIM3_IRQn);
+    __HAL_RCC_TIM3_CLK_DISABLE();
+}
+
+/*
+ * The counter and the edge capture are opened and closed with interrupts
+ * off so both see the same gate, measured in micros().
+ */
+static void MEASURE_GateOpen(void) {
+    __disable_irq();
+    TIM3->CNT = 0;
+    TIM3->SR = 0;
+    measure_overflows = 0;
+    TIM3->CR1 = TIM_CR1_CEN;
+    measure_gate_start = micros();
+    capture.open = true;
+    __enable_irq();
+}
+
+/**
+ * @brief Close the gate opened by MEASURE_GateOpen()
+ * @param gate_us: Set to the time the gate was open
+ * @return Rising edges in the gate
+ */
+static uint32_t MEASURE_GateClose(uint32_t* gate_us) {
+    uint32_t edges;
+
+    __disable_irq();
+    TIM3->CR1 = 0;
+    *gate_us = micros() - measure_gate_start;
+    capture.open = false;
+    if (TIM3->SR & TIM_SR_UIF) {
+        TIM3->SR = ~TIM_SR_UIF;
+        measure_overflows++;
+    }
+    edges = (measure_overflows << 16) | TIM3->CNT;
+    __enable_irq();
+
+    return edges;
+}
+
+/* Release TIM3, the EXTI hook and the pin */
+static void MEASURE_Release(void) {
+    if (measure_result.timed) {
+        GPIO_SetEdgeHook(measure_pin, NULL);
+    }
+    MEASURE_TimerStop();
+    MEASURE_PinMode(measure_pin, false);
+    measure_state = MEASURE_IDLE;
+}
+
+/* Derive frequency and duty from the closed main gate */
+static void MEASURE_Compute(MEASURE_Result* result) {
+    uint64_t milli_hz;
+
+    result->level = (measure_pin->GPIOx->IDR & measure_pin->GPIO_Pin) ? 1 : 0;
+    result->missed = capture.missed;
+    result->high = capture.high;
+    result->low = capture.low;
+
+    if (result->timed && capture.missed == 0 && capture.rises >= 2 &&
+        capture.last_rise_us != capture.first_rise_us) {
+        milli_hz = (uint64_t)(capture.rises - 1) * 1000000000U / (capture.last_rise_us - capture.first_rise_us);
+    } else {
+        milli_hz = (uint64_t)result->edges * 1000000000U / result->window_us;
+    }
+    result->freq_hz = milli_hz / 1000;
+    result->freq_milli = milli_hz % 1000;
+
+    if (result->high.count && result->low.count) {
+        // Mean high over mean period, without dividing the sums first
+        uint64_t high = (uint64_t)result->high.sum_us * result->low.count;
+        uint64_t low = (uint64_t)result->low.sum_us * result->high.count;
+        result->duty_permille = (high * 1000 + (high + low) / 2) / (high + low);
+    } else if (result->edges == 0) {
+        result->duty_permille = result->level ? 1000 : 0;
+    }
+}
+
+HAL_StatusTypeDef MEASURE_Start(uint32_t window_ms) {
+    const GPIO_InputConfig* pin = GPIO_FindInputByName(MEASURE_PIN_NAME);
+
+    if (measure_state != MEASURE_IDLE) {
+        return HAL_BUSY;
+    }
+    if (pin == NULL) {
+        return HAL_ERROR;
+    }
+    if (window_ms == 0) window_ms = MEASURE_DEFAULT_WINDOW_MS;
+    if (window_ms > MEASURE_MAX_WINDOW_MS) window_ms = MEASURE_MAX_WINDOW_MS;
+    memset(&measure_result, 0, sizeof(measure_result));
+    memset((void*)&capture, 0, sizeof(capture));
+    measure_pin = pin;
+    measure_window_ms = window_ms;
+
+    MEASURE_PinMode(pin, true);
+    MEASURE_TimerInit();
+    MEASURE_GateOpen();
+    measure_state = MEASURE_PROBE;
+    return HAL_OK;
+}
+
+void MEASURE_Process(void) {
+    MEASURE_Result* result = &measure_result;
+    char reply[CMD_REPLY_SIZE];
+    uint32_t probe_edges;
+    uint32_t probe_us;
+
+    switch (measure_state) {
+        case MEASURE_IDLE:
+            return;
+
+        case MEASURE_PROBE:
+            if (micros() - measure_gate_start < MEASURE_PROBE_MS * 1000U) {
+                return;
+            }
+            probe_edges = MEASURE_GateClose(&probe_us);
+            result->timed = (uint64_t)probe_edges * 1000000U <= (uint64_t)MEASURE_EDGE_MAX_HZ * probe_us;
+            if (result->timed && GPIO_SetEdgeHook(measure_pin, MEASURE_Edge) != HAL_OK) {
+                if(DEBUG_GPIO) printf("Error: EXTI line of %s in use\n", measure_pin->name);
+                result->timed = false;
+                MEASURE_Release();
+                sendReply("MEASURE", "BUSY");
+                return;
+            }
+            MEASURE_GateOpen();
+            measure_state = MEASURE_GATE;
+            return;
+
+        case MEASURE_GATE:
+            if (micros() - measure_gate_start < measure_window_ms * 1000U) {
+                return;
+            }
+            result->edges = MEASURE_GateClose(&result->window_us);
+            MEASURE_Release();
+            MEASURE_Compute(result);
+            MEASURE_Format(reply, result);
+            sendReply("MEASURE", reply);
+            return;
+    }
+}
+
+/* "min/mean/max", or "-" with no samples */
+static void MEASURE_WidthFormat(char* out, const MEASURE_Width* width) {
+    if (width->count == 0) {
+        strcpy(out, "-");
+        return;
+    }
+    sprintf(out, "%lu/%lu/%lu", (unsigned long)width->min_us,
+            (unsigned long)(width->sum_us / width->count), (unsigned long)width->max_us);
+}
+
+void MEASURE_Format(char* buffer, const MEASURE_Result* result) {
+    char high[36];
+    char low[36];
+
+    sprintf(buffer, "freq=%lu.%03u", (unsigned long)result->freq_hz, result->freq_milli);
+    if (result->timed || result->edges == 0) {
+        MEASURE_WidthFormat(high, &result->high);
+        MEASURE_WidthFormat(low, &result->low);
+        sprintf(buffer + strlen(buffer), " duty=%u.%u high_us=%s low_us=%s",
+                result->duty_permille / 10, result->duty_permille % 10, high, low);
+    } else {
+        strcat(buffer, " duty=- high_us=- low_us=-");
+    }
+    sprintf(buffer + strlen(buffer), " edges=%lu window_us=%lu level=%u",
+            (unsigned long)result->edges, (unsigned long)result->window_us, result->level);
+    if (result->missed) {
+        sprintf(buffer + strlen(buffer), " missed=%lu", (unsigned long)result->missed);
+    }
+}
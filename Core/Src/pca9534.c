@@ -1,29 +1,46 @@
 #include "pca9534.h"
+#include "i2c.h"
+
+#define PCA9534_IT_WAIT_MS  (2 * I2C_MASTER_TIMEOUT_MS)   // In-flight write plus one coalesced resend
+
+/* Let an interrupt-driven output write finish before a blocking transfer. */
+static PCA9534_StatusTypeDef PCA9534_WaitIdle(PCA9534_HandleTypeDef *hpca9534)
+{
+    uint32_t start = HAL_GetTick();
+    while (hpca9534->TxBusy)
+    {
+        if (HAL_GetTick() - start > PCA9534_IT_WAIT_MS)
+        {
+            return PCA9534_ERROR;
+        }
+    }
+    return PCA9534_OK;
+}
 
 /* Helper function to write a value to a PCA9534 register. */
 static PCA9534_StatusTypeDef PCA9534_WriteReg(PCA9534_HandleTypeDef *hpca9534, uint8_t reg, uint8_t value)
 {
-    uint8_t buf[2];
-    buf[0] = reg;
-    buf[1] = value;
-    
-    if (HAL_I2C_Master_Transmit(hpca9534->hi2c, hpca9534->DevAddress, buf, 2, HAL_MAX_DELAY) != HAL_OK)
+    if (PCA9534_WaitIdle(hpca9534) != PCA9534_OK)
+    {
+        return PCA9534_ERROR;
+    }
+
+    if (I2C_MasterWriteReg(hpca9534->DevAddress, reg, &value, 1) != HAL_OK)
     {
         return PCA9534_ERROR;
     }
     return PCA9534_OK;
 }
 
-/* Helper function to read a value from a PCA9534 register. */
+/* Helper function to read a value from a PCA9534 register (repeated start, one transaction). */
 static PCA9534_StatusTypeDef PCA9534_ReadReg(PCA9534_HandleTypeDef *hpca9534, uint8_t reg, uint8_t *value)
 {
-    /* Send the register address */
-    if (HAL_I2C_Master_Transmit(hpca9534->hi2c, hpca9534->DevAddress, &reg, 1, HAL_MAX_DELAY) != HAL_OK)
+    if (PCA9534_WaitIdle(hpca9534) != PCA9534_OK)
     {
         return PCA9534_ERROR;
     }
-    /* Receive the register value */
-    if (HAL_I2C_Master_Receive(hpca9534->hi2c, hpca9534->DevAddress, value, 1, HAL_MAX_DELAY) != HAL_OK)
+
+    if (I2C_MasterReadReg(hpca9534->DevAddress, reg, value, 1) != HAL_OK)
     {
         return PCA9534_ERROR;
     }
@@ -32,13 +49,49 @@ static PCA9534_StatusTypeDef PCA9534_ReadReg(PCA9534_HandleTypeDef *hpca9534, ui
 
 PCA9534_StatusTypeDef PCA9534_Init(PCA9534_HandleTypeDef *hpca9534, I2C_HandleTypeDef *hi2c, uint16_t DevAddress)
 {
-    if (hpca9534 == NULL || hi2c == NULL)
+    /* All transfers go through the I2C2 master queue */
+    if (hpca9534 == NULL || hi2c != &hi2c2)
     {
         return PCA9534_ERROR;
     }
     hpca9534->hi2c = hi2c;
     hpca9534->DevAddress = DevAddress;
-    /* Additional initialization can be performed here if needed */
+
+    /* Power-on defaults, replaced by the device contents below */
+    hpca9534->OutputShadow = 0xFF;
+    hpca9534->OutputRequest = 0xFF;
+    hpca9534->ConfigShadow = 0xFF;
+    hpca9534->InputCache = 0x00;
+    hpca9534->InputValid = false;
+    hpca9534->IntTracking = false;
+    hpca9534->IntCount = 0;
+    hpca9534->InputReads = 0;
+    hpca9534->TxBusy = false;
+    hpca9534->TxPending = false;
+    hpca9534->TxRequests = 0;
+    hpca9534->TxErrors = 0;
+
+    return PCA9534_SyncShadow(hpca9534);
+}
+
+PCA9534_StatusTypeDef PCA9534_SyncShadow(PCA9534_HandleTypeDef *hpca9534)
+{
+    uint8_t output;
+    uint8_t config;
+
+    if (PCA9534_ReadReg(hpca9534, PCA9534_REG_OUTPUT, &output) != PCA9534_OK)
+    {
+        return PCA9534_ERROR;
+    }
+    if (PCA9534_ReadReg(hpca9534, PCA9534_REG_CONFIG, &config) != PCA9534_OK)
+    {
+        return PCA9534_ERROR;
+    }
+
+    hpca9534->OutputShadow = output;
+    hpca9534->OutputRequest = output;
+    hpca9534->ConfigShadow = config;
+    hpca9534->InputValid = false;
     return PCA9534_OK;
 }
 
@@ -47,44 +100,197 @@ PCA9534_StatusTypeDef PCA9534_Init(PCA9534_HandleTypeDef *hpca9534, I2C_HandleTy
  */
 PCA9534_StatusTypeDef PCA9534_TogglePin(PCA9534_HandleTypeDef *hpca9534, uint8_t pin)
 {
-    uint8_t currentOutput;
+    /* Toggle the specified pin by XORing with the pin mask */
+    return PCA9534_WriteOutput(hpca9534, hpca9534->OutputRequest ^ pin);
+}
 
-    /* Read the current state of the output register */
-    if (PCA9534_ReadReg(hpca9534, PCA9534_REG_OUTPUT, &currentOutput) != PCA9534_OK)
+PCA9534_StatusTypeDef PCA9534_SetConfig(PCA9534_HandleTypeDef *hpca9534, uint8_t config)
+{
+    if (PCA9534_WriteReg(hpca9534, PCA9534_REG_CONFIG, config) != PCA9534_OK)
     {
         return PCA9534_ERROR;
     }
+    hpca9534->ConfigShadow = config;
+    hpca9534->InputValid = false;
+    return PCA9534_OK;
+}
 
-    /* Toggle the specified pin by XORing with the pin mask */
-    currentOutput ^= pin;
+PCA9534_StatusTypeDef PCA9534_SetPinDirection(PCA9534_HandleTypeDef *hpca9534, uint8_t pin, bool input)
+{
+    uint8_t config = input ? (hpca9534->ConfigShadow | pin) : (hpca9534->ConfigShadow & ~pin);
 
-    /* Write the new output state */
-    return PCA9534_WriteReg(hpca9534, PCA9534_REG_OUTPUT, currentOutput);
+    if (config == hpca9534->ConfigShadow)
+    {
+        return PCA9534_OK;
+    }
+    return PCA9534_SetConfig(hpca9534, config);
 }
 
-PCA9534_StatusTypeDef PCA9534_SetConfig(PCA9534_HandleTypeDef *hpca9534, uint8_t config)
+PCA9534_StatusTypeDef PCA9534_GetConfig(PCA9534_HandleTypeDef *hpca9534, uint8_t *config)
 {
-    return PCA9534_WriteReg(hpca9534, PCA9534_REG_CONFIG, config);
+    *config = hpca9534->ConfigShadow;
+    return PCA9534_OK;
 }
 
-PCA9534_StatusTypeDef PCA9534_GetConfig(PCA9534_HandleTypeDef *hpca9534, uint8_t *config)
+/*
+ * The output register only changes the cached level of output pins. With INTn
+ * tracking those bits are patched from the shadow; otherwise the whole cache
+ * is dropped as before.
+ */
+static void PCA9534_OutputChanged(PCA9534_HandleTypeDef *hpca9534)
 {
-    return PCA9534_ReadReg(hpca9534, PCA9534_REG_CONFIG, config);
+    if (hpca9534->IntTracking)
+    {
+        hpca9534->InputCache = (hpca9534->InputCache & hpca9534->ConfigShadow) |
+                               (hpca9534->OutputShadow & ~hpca9534->ConfigShadow);
+    }
+    else
+    {
+        hpca9534->InputValid = false;
+    }
 }
 
 PCA9534_StatusTypeDef PCA9534_WriteOutput(PCA9534_HandleTypeDef *hpca9534, uint8_t value)
 {
-    return PCA9534_WriteReg(hpca9534, PCA9534_REG_OUTPUT, value);
+    /* Only commit the shadow once the device has accepted the value */
+    if (PCA9534_WriteReg(hpca9534, PCA9534_REG_OUTPUT, value) != PCA9534_OK)
+    {
+        return PCA9534_ERROR;
+    }
+    hpca9534->OutputShadow = value;
+    hpca9534->OutputRequest = value;
+    PCA9534_OutputChanged(hpca9534);
+    return PCA9534_OK;
+}
+
+static void PCA9534_OutputDone(HAL_StatusTypeDef status, void *context);
+
+/* Queue a write of the newest requested output value. */
+static PCA9534_StatusTypeDef PCA9534_StartOutput_IT(PCA9534_HandleTypeDef *hpca9534)
+{
+    I2C_MasterXfer xfer = {0};
+
+    xfer.dev_address = hpca9534->DevAddress;
+    xfer.reg = PCA9534_REG_OUTPUT;
+    xfer.length = 1;
+    xfer.data[0] = hpca9534->OutputRequest;
+    xfer.callback = PCA9534_OutputDone;
+    xfer.context = hpca9534;
+    hpca9534->TxValue = hpca9534->OutputRequest;
+    hpca9534->TxSerial = hpca9534->TxRequests;
+    hpca9534->TxBusy = true;
+
+    if (I2C_MasterSubmit(&xfer) != HAL_OK)
+    {
+        /* Nothing reached the device: fall back to what it holds */
+        hpca9534->TxBusy = false;
+        hpca9534->TxErrors++;
+        hpca9534->OutputRequest = hpca9534->OutputShadow;
+        PCA9534_OutputDoneCallback(hpca9534, hpca9534->TxSerial, false);
+        return PCA9534_ERROR;
+    }
+    return PCA9534_OK;
+}
+
+PCA9534_StatusTypeDef PCA9534_WriteOutput_IT(PCA9534_HandleTypeDef *hpca9534, uint8_t value)
+{
+    hpca9534->OutputRequest = value;
+    hpca9534->TxRequests++;
+
+    if (hpca9534->TxBusy)
+    {
+        hpca9534->TxPending = true;
+        return PCA9534_OK;
+    }
+    return PCA9534_StartOutput_IT(hpca9534);
+}
+
+/* I2C master queue callback for PCA9534_WriteOutput_IT. */
+static void PCA9534_OutputDone(HAL_StatusTypeDef status, void *context)
+{
+    PCA9534_HandleTypeDef *hpca9534 = (PCA9534_HandleTypeDef *)context;
+    uint8_t serial = hpca9534->TxSerial;
+
+    /* Only commit the shadow once the device has accepted the value */
+    if (status == HAL_OK)
+    {
+        hpca9534->OutputShadow = hpca9534->TxValue;
+        PCA9534_OutputChanged(hpca9534);
+    }
+    else
+    {
+        hpca9534->TxErrors++;
+        if (!hpca9534->TxPending)
+        {
+            hpca9534->OutputRequest = hpca9534->OutputShadow;
+        }
+    }
+    PCA9534_OutputDoneCallback(hpca9534, serial, status == HAL_OK);
+
+    if (hpca9534->TxPending)
+    {
+        hpca9534->TxPending = false;
+        PCA9534_StartOutput_IT(hpca9534);
+    }
+    else
+    {
+        hpca9534->TxBusy = false;
+    }
+}
+
+__weak void PCA9534_OutputDoneCallback(PCA9534_HandleTypeDef *hpca9534, uint8_t serial, bool ok)
+{
+    (void)hpca9534;
+    (void)serial;
+    (void)ok;
+}
+
+PCA9534_StatusTypeDef PCA9534_GetOutput(PCA9534_HandleTypeDef *hpca9534, uint8_t *value)
+{
+    *value = hpca9534->OutputShadow;
+    return PCA9534_OK;
 }
 
 PCA9534_StatusTypeDef PCA9534_ReadInput(PCA9534_HandleTypeDef *hpca9534, uint8_t *value)
 {
-    return PCA9534_ReadReg(hpca9534, PCA9534_REG_INPUT, value);
+    /* An INTn edge while the read is in flight may not be in the value read */
+    uint32_t int_count = hpca9534->IntCount;
+
+    hpca9534->InputReads++;
+    if (PCA9534_ReadReg(hpca9534, PCA9534_REG_INPUT, &hpca9534->InputCache) != PCA9534_OK)
+    {
+        hpca9534->InputValid = false;
+        return PCA9534_ERROR;
+    }
+    hpca9534->InputValid = (int_count == hpca9534->IntCount);
+    *value = hpca9534->InputCache;
+    return PCA9534_OK;
+}
+
+void PCA9534_NotifyInt(PCA9534_HandleTypeDef *hpca9534)
+{
+    hpca9534->IntCount++;
+    hpca9534->InputValid = false;
+}
+
+PCA9534_StatusTypeDef PCA9534_GetInput(PCA9534_HandleTypeDef *hpca9534, uint8_t *value, bool refresh)
+{
+    if (refresh || !hpca9534->InputValid)
+    {
+        return PCA9534_ReadInput(hpca9534, value);
+    }
+    *value = hpca9534->InputCache;
+    return PCA9534_OK;
 }
 
 PCA9534_StatusTypeDef PCA9534_SetPolarity(PCA9534_HandleTypeDef *hpca9534, uint8_t polarity)
 {
-    return PCA9534_WriteReg(hpca9534, PCA9534_REG_POLARITY, polarity);
+    if (PCA9534_WriteReg(hpca9534, PCA9534_REG_POLARITY, polarity) != PCA9534_OK)
+    {
+        return PCA9534_ERROR;
+    }
+    hpca9534->InputValid = false;
+    return PCA9534_OK;
 }
 
 PCA9534_StatusTypeDef PCA9534_GetPolarity(PCA9534_HandleTypeDef *hpca9534, uint8_t *polarity)
@@ -97,21 +303,16 @@ PCA9534_StatusTypeDef PCA9534_GetPolarity(PCA9534_HandleTypeDef *hpca9534, uint8
  */
 PCA9534_StatusTypeDef PCA9534_WritePin(PCA9534_HandleTypeDef *hpca9534, uint8_t pin, uint8_t value)
 {
-    uint8_t currentOutput;
-    /* Read the current state of the output register */
-    if (PCA9534_ReadReg(hpca9534, PCA9534_REG_OUTPUT, &currentOutput) != PCA9534_OK)
-    {
-        return PCA9534_ERROR;
-    }
-    
+    uint8_t newOutput = hpca9534->OutputRequest;
+
     if (value)
     {
-        currentOutput |= pin;   // Set the specified pin high.
+        newOutput |= pin;   // Set the specified pin high.
     }
     else
     {
-        currentOutput &= ~pin;  // Clear the specified pin (drive low).
+        newOutput &= ~pin;  // Clear the specified pin (drive low).
     }
-    
-    return PCA9534_WriteReg(hpca9534, PCA9534_REG_OUTPUT, currentOutput);
+
+    return PCA9534_WriteOutput(hpca9534, newOutput);
 }
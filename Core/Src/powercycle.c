@@ -0,0 +1,225 @@
+/*
+ * powercycle.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: mavorpdx
+ *
+ * On-device power-cycle screen. Each cycle cuts the DUT enables, waits the
+ * off time, re-enables them, then waits for power-good and the DUT banner.
+ * It runs as a state machine from the main loop so the command port stays
+ * live (CYCLE for progress, CYCLE_STOP to end early).
+ *
+ * Times are measured from the enable write. The power-good edge comes from
+ * the input's last-edge timestamp (exact for EXTI-armed inputs, 1 ms
+ * otherwise) and the banner from the UART receive watch, so neither depends
+ * on how often the main loop gets here.
+ */
+#include <string.h>
+#include <stdio.h>
+
+#include "main.h"
+#include "powercycle.h"
+#include "command.h"
+
+typedef enum {
+    CYCLE_IDLE,
+    CYCLE_OFF,          // Enables cut, waiting off_ms
+    CYCLE_POWER_GOOD,   // Enables on, waiting for power-good
+    CYCLE_BANNER        // Waiting for the DUT banner
+} CYCLE_State;
+
+static CYCLE_Config cycle_cfg;
+static CYCLE_State cycle_state = CYCLE_IDLE;
+static bool cycle_stop = false;
+static bool cycle_off_failed = false;       // The power-off write of the next cycle failed
+static uint32_t cycle_done;                 // Cycles finished (passed or failed)
+static uint32_t cycle_failures;
+static const char* cycle_last_failure = "";
+static uint32_t cycle_state_ms;             // millis() when the current state started
+static uint32_t cycle_on_us;                // micros() right after the enable write
+static uint32_t cycle_write_us;             // micros() right before the enable write
+static CYCLE_Stat cycle_pg_stat;
+static CYCLE_Stat cycle_boot_stat;
+
+static void CYCLE_StatAdd(CYCLE_Stat* stat, uint32_t us) {
+    if (stat->count == 0 || us < stat->min_us) stat->min_us = us;
+    if (stat->count == 0 || us > stat->max_us) stat->max_us = us;
+    stat->sum_us += us;
+    stat->count++;
+}
+
+/* "min/mean/max", or "-" with no samples */
+static void CYCLE_StatFormat(char* out, const CYCLE_Stat* stat) {
+    if (stat->count == 0) {
+        strcpy(out, "-");
+        return;
+    }
+    sprintf(out, "%lu/%lu/%lu", (unsigned long)stat->min_us,
+            (unsigned long)(stat->sum_us / stat->count), (unsigned long)stat->max_us);
+}
+
+/* One line summary: done/total, failures, power-good and boot min/mean/max */
+static void CYCLE_Summary(char* out) {
+    char pg[36];
+    char boot[36];
+
+    CYCLE_StatFormat(pg, &cycle_pg_stat);
+    CYCLE_StatFormat(boot, &cycle_boot_stat);
+    sprintf(out, "cycles=%lu/%lu fail=%lu pg_us=%s boot_us=%s",
+            (unsigned long)cycle_done, (unsigned long)cycle_cfg.cycles,
+            (unsigned long)cycle_failures, pg, boot);
+}
+
+static HAL_StatusTypeDef CYCLE_SetPower(GPIO_PinState state) {
+    GPIO_PinWrite writes[CYCLE_MAX_ENABLES];
+
+    for (int i = 0; i < cycle_cfg.enable_count; i++) {
+        writes[i].config = cycle_cfg.enables[i];
+        writes[i].state = state;
+    }
+    return GPIO_WritePins(writes, cycle_cfg.enable_count);
+}
+
+static bool CYCLE_PowerGoodActive(void) {
+    const GPIO_InputConfig* pg = cycle_cfg.power_good;
+    return ((pg->GPIOx->IDR & pg->GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET) == pg->activeState;
+}
+
+/* Close the current cycle and either start the next one or report */
+static void CYCLE_Next(void) {
+    UART_WatchStop();
+    cycle_done++;
+
+    if (cycle_done >= cycle_cfg.cycles || cycle_stop) {
+        char msg[120];
+        cycle_state = CYCLE_IDLE;
+        strcpy(msg, "DONE ");
+        CYCLE_Summary(msg + strlen(msg));
+        sendReply("CYCLE", msg);
+        return;
+    }
+
+    // Failed in CYCLE_Process so the cycle is counted without recursing into here
+    cycle_off_failed = (CYCLE_SetPower(GPIO_PIN_RESET) != HAL_OK);
+    cycle_state = CYCLE_OFF;
+    cycle_state_ms = millis();
+}
+
+static void CYCLE_Fail(const char* reason) {
+    cycle_failures++;
+    cycle_last_failure = reason;
+    sprintf(tStr, "cycle %lu failed: %s", (unsigned long)cycle_done + 1, reason);
+    sendDebug("CYCLE", tStr);
+    CYCLE_Next();
+}
+
+HAL_StatusTypeDef CYCLE_Start(const CYCLE_Config* config) {
+    // The banner watch is shared with BOOTTIME
+    if (cycle_state != CYCLE_IDLE || UART_WatchActive()) {
+        return HAL_BUSY;
+    }
+    if (config == NULL || config->cycles == 0 || config->enable_count <= 0 ||
+        config->enable_count > CYCLE_MAX_ENABLES) {
+        return HAL_ERROR;
+    }
+
+    cycle_cfg = *config;
+    cycle_stop = false;
+    cycle_done = 0;
+    cycle_failures = 0;
+    cycle_last_failure = "";
+    cycle_off_failed = false;
+    memset(&cycle_pg_stat, 0, sizeof(cycle_pg_stat));
+    memset(&cycle_boot_stat, 0, sizeof(cycle_boot_stat));
+
+    if (CYCLE_SetPower(GPIO_PIN_RESET) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    cycle_state = CYCLE_OFF;
+    cycle_state_ms = millis();
+    return HAL_OK;
+}
+
+bool CYCLE_Running(void) {
+    return cycle_state != CYCLE_IDLE;
+}
+
+void CYCLE_Stop(void) {
+    if (cycle_state == CYCLE_IDLE) {
+        return;
+    }
+    // The cycle in progress is counted as done so the report adds up
+    cycle_stop = true;
+    CYCLE_Next();
+}
+
+void CYCLE_PrintStatus(char* buffer) {
+    static const char* const states[] = { "IDLE", "OFF", "POWER_GOOD", "BANNER" };
+
+    sprintf(tStr, "%s ", states[cycle_state]);
+    strcat(buffer, tStr);
+    CYCLE_Summary(buffer + strlen(buffer));
+    if (cycle_last_failure[0]) {
+        strcat(buffer, " last_fail=");
+        strcat(buffer, cycle_last_failure);
+    }
+}
+
+void CYCLE_Process(void) {
+    uint32_t when;
+    uint8_t level;
+
+    switch (cycle_state) {
+        case CYCLE_IDLE:
+            return;
+
+        case CYCLE_OFF:
+            if (cycle_off_failed) {
+                cycle_off_failed = false;
+                CYCLE_Fail("ENABLE_WRITE");
+                return;
+            }
+            if (millis() - cycle_state_ms < cycle_cfg.off_ms) {
+                return;
+            }
+            if (cycle_cfg.power_good && CYCLE_PowerGoodActive()) {
+                CYCLE_Fail("PG_STUCK");
+                return;
+            }
+            if (cycle_cfg.port) {
+                UART_WatchStart(cycle_cfg.port, cycle_cfg.pattern);
+            }
+            cycle_write_us = micros();
+            if (CYCLE_SetPower(GPIO_PIN_SET) != HAL_OK) {
+                CYCLE_Fail("ENABLE_WRITE");
+                return;
+            }
+            cycle_on_us = micros();
+            cycle_state_ms = millis();
+            cycle_state = cycle_cfg.power_good ? CYCLE_POWER_GOOD : CYCLE_BANNER;
+            return;
+
+        case CYCLE_POWER_GOOD:
+            GPIO_GetLastEdge(cycle_cfg.power_good, &level, &when);
+            if (level == (cycle_cfg.power_good->activeState == GPIO_PIN_SET) &&
+                (int32_t)(when - cycle_write_us) >= 0) {
+                // An edge during the enable write itself counts as 0
+                CYCLE_StatAdd(&cycle_pg_stat, (int32_t)(when - cycle_on_us) > 0 ? when - cycle_on_us : 0);
+                cycle_state = CYCLE_BANNER;
+            } else if (millis() - cycle_state_ms > cycle_cfg.timeout_ms) {
+                CYCLE_Fail("PG_TIMEOUT");
+            }
+            return;
+
+        case CYCLE_BANNER:
+            if (cycle_cfg.port == NULL) {
+                CYCLE_Next();
+            } else if (UART_WatchDone(&when)) {
+                CYCLE_StatAdd(&cycle_boot_stat, when - cycle_on_us);
+                CYCLE_Next();
+            } else if (millis() - cycle_state_ms > cycle_cfg.timeout_ms) {
+                CYCLE_Fail("BANNER_TIMEOUT");
+            }
+            return;
+    }
+}
@@ -0,0 +1,220 @@
+/*
+ * profile.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: mavorpdx
+ *
+ * Per-model DUT profiles (SLCD5, SLCD43, SLCD6), switched with PROFILE.
+ *
+ * A profile is a const table entry: which DUT connector each tester port
+ * reaches and its rate limit, the outputs to drive on changeover, the ADC
+ * scale and acceptance windows and the COM1 transceiver mode. controllerType
+ * is the index of the current entry. Selecting a profile applies all of it
+ * in one call, and only ports whose rate changes are re-initialised.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <strings.h>
+
+#include "main.h"
+#include "profile.h"
+#include "uart.h"
+
+#define PORT(connector, baud_max, baud, ttl_only)   { connector, baud_max, baud, ttl_only }
+#define PORT_UNUSED                                 { NULL, SERIAL_BAUD_MAX, SERIAL_BAUD, false }
+
+// The tester's dividers are the same for every model, the windows are the
+// DUT rails. All three models have 12 V, 5 V and 3.3 V rails, so they share
+// one table until one of them needs its own.
+static const ADC_Scale profile_adc_slcd[ADC_CHANNEL_COUNT] = {
+    { 25150, 3785, 10800, 13200 },      // INV_12V_J2
+    { 25150, 3785, 4750, 5250 },        // MAIN_5V_J2
+    { 25150, 3785, 10800, 13200 },      // INV_12V
+    { 250, 157, 3135, 3465 },           // 3V3_PERI
+    { 250, 157, 4750, 5250 },           // VOLT5V0
+};
+
+// Indexed by controllerType
+static const PROFILE_Config profile_table[PROFILE_COUNT] = {
+    [SLCD5_TYPE] = {
+        .name = "SLCD5",
+        .ports = {
+            [PROFILE_PORT_COM0]   = PORT("J6", SERIAL_BAUD_MAX, SERIAL_BAUD, false),    // 8 pin
+            [PROFILE_PORT_COM1]   = PORT("J7", SERIAL_BAUD_MAX, SERIAL_BAUD, false),    // 10 pin
+            [PROFILE_PORT_COM2]   = PORT_UNUSED,
+            [PROFILE_PORT_COM3]   = { NULL, USB_BAUD, USB_BAUD, false },
+            [PROFILE_PORT_COM485] = PORT("J7", SERIAL_BAUD_MAX, SERIAL_BAUD, false),    // 10 pin
+        },
+        .outputs = {
+            { "SER1_RS232_EN", GPIO_PIN_RESET },
+            { "RS232_5_RTS", GPIO_PIN_RESET },
+            { "RS485_4_DE", GPIO_PIN_RESET },
+            { "COM2_RSTn", GPIO_PIN_RESET },
+            { "5V_VMAIN_PG", GPIO_PIN_SET },
+            { "VIN_INV_EN", GPIO_PIN_SET },
+            { "VIN_MAIN_EN", GPIO_PIN_SET },
+            { "V5_INV_EN", GPIO_PIN_SET },
+            { "V5_MAIN_EN", GPIO_PIN_SET },
+        },
+        .adc = profile_adc_slcd,
+        .serial_cfg = 0,        // RS-232
+    },
+    [SLCD43_TYPE] = {
+        .name = "SLCD43",
+        .ports = {
+            [PROFILE_PORT_COM0]   = PORT("J2", 230400, SERIAL_BAUD, false),             // 8 pin
+            [PROFILE_PORT_COM1]   = PORT("J1", SERIAL_BAUD_MAX, SERIAL_BAUD, true),     // 10 pin
+            [PROFILE_PORT_COM2]   = PORT("J4", SERIAL_BAUD_MAX, SERIAL_BAUD, false),    // 10 pin
+            [PROFILE_PORT_COM3]   = PORT("J3", 460800, USB_BAUD, false),                // 5 pin
+            [PROFILE_PORT_COM485] = PORT_UNUSED,
+        },
+        .outputs = {
+            { "SER1_RS232_EN", GPIO_PIN_RESET },
+            { "RS232_5_RTS", GPIO_PIN_RESET },
+            { "RS485_4_DE", GPIO_PIN_RESET },
+            { "COM2_RSTn", GPIO_PIN_SET },      // COM2 is used, keep it out of reset
+            { "5V_VMAIN_PG", GPIO_PIN_SET },
+            { "VIN_INV_EN", GPIO_PIN_SET },
+            { "VIN_MAIN_EN", GPIO_PIN_SET },
+            { "V5_INV_EN", GPIO_PIN_SET },
+            { "V5_MAIN_EN", GPIO_PIN_SET },
+        },
+        .adc = profile_adc_slcd,
+        .serial_cfg = 2,        // TTL, COM1 has no transceiver
+    },
+    [SCLD6_TYPE] = {
+        .name = "SLCD6",
+        .ports = {
+            [PROFILE_PORT_COM0]   = PORT("J6", 230400, SERIAL_BAUD, false),             // 8 pin
+            [PROFILE_PORT_COM1]   = PORT("JP1", SERIAL_BAUD_MAX, SERIAL_BAUD, true),    // 10 pin
+            [PROFILE_PORT_COM2]   = PORT("J9", SERIAL_BAUD_MAX, SERIAL_BAUD, false),    // 5 pin
+            [PROFILE_PORT_COM3]   = PORT("CN1", 460800, USB_BAUD, false),               // 5 pin
+            [PROFILE_PORT_COM485] = PORT_UNUSED,
+        },
+        .outputs = {
+            { "SER1_RS232_EN", GPIO_PIN_RESET },
+            { "RS232_5_RTS", GPIO_PIN_RESET },
+            { "RS485_4_DE", GPIO_PIN_RESET },
+            { "COM2_RSTn", GPIO_PIN_SET },
+            { "5V_VMAIN_PG", GPIO_PIN_SET },
+            { "VIN_INV_EN", GPIO_PIN_SET },
+            { "VIN_MAIN_EN", GPIO_PIN_SET },
+            { "V5_INV_EN", GPIO_PIN_SET },
+            { "V5_MAIN_EN", GPIO_PIN_SET },
+        },
+        .adc = profile_adc_slcd,
+        .serial_cfg = 2,        // TTL, COM1 has no transceiver
+    },
+};
+
+// Rate variable and re-init call of each tester port
+static const struct {
+    const char* name;
+    uint32_t* baud;
+    void (*set)(uint32_t);
+} profile_uarts[PROFILE_PORT_COUNT] = {
+    [PROFILE_PORT_COM0]   = { "COM0", &comBaud0, SetBaudRate_COM0 },
+    [PROFILE_PORT_COM1]   = { "COM1", &comBaud1, SetBaudRate_COM1 },
+    [PROFILE_PORT_COM2]   = { "COM2", &comBaud2, SetBaudRate_COM2 },
+    [PROFILE_PORT_COM3]   = { "COM3", &comBaud3, SetBaudRate_COM3 },
+    [PROFILE_PORT_COM485] = { "COM485", &comBaud485, SetBaudRate_COM485 },
+};
+
+_Static_assert(PROFILE_COUNT == SCLD6_TYPE + 1, "profile_table[] is indexed by controllerType");
+
+/* Default outputs of a profile in one GPIO_WritePins() batch */
+static HAL_StatusTypeDef PROFILE_ApplyOutputs(const PROFILE_Config* profile) {
+    GPIO_PinWrite writes[PROFILE_MAX_OUTPUTS];
+    int count = 0;
+
+    for (int i = 0; i < PROFILE_MAX_OUTPUTS && profile->outputs[i].name; i++) {
+        writes[count].config = GPIO_FindByName(profile->outputs[i].name);
+        writes[count].state = profile->outputs[i].state;
+        if (writes[count].config == NULL) {
+            // Switched to an input with PCA_DIR, or a stale pin name
+            if(DEBUG_GPIO) printf("Error: profile %s output %s not found\n", profile->name, profile->outputs[i].name);
+            return HAL_ERROR;
+        }
+        count++;
+    }
+    return count ? GPIO_WritePins(writes, count) : HAL_OK;
+}
+
+HAL_StatusTypeDef PROFILE_Select(uint8_t type, bool apply_defaults) {
+    const PROFILE_Config* profile;
+    HAL_StatusTypeDef status = HAL_OK;
+
+    if (type >= PROFILE_COUNT) {
+        return HAL_ERROR;
+    }
+    profile = &profile_table[type];
+    controllerType = type;
+    ADC_SetScale(profile->adc);
+
+    if (!apply_defaults) {
+        return HAL_OK;
+    }
+    for (int i = 0; i < PROFILE_PORT_COUNT; i++) {
+        PROFILE_SetBaud(i, profile->ports[i].baud);
+    }
+    // Outputs first: the transceiver pins are then set by the serial mode
+    status = PROFILE_ApplyOutputs(profile);
+    serialCFG = profile->serial_cfg;
+    setSerialCFG();
+    return status;
+}
+
+int PROFILE_Find(const char* name) {
+    for (int i = 0; i < PROFILE_COUNT; i++) {
+        if (strcasecmp(name, profile_table[i].name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const PROFILE_Config* PROFILE_Current(void) {
+    return &profile_table[controllerType < PROFILE_COUNT ? controllerType : SLCD5_TYPE];
+}
+
+uint32_t PROFILE_ClampBaud(PROFILE_Port port, uint32_t baud) {
+    uint32_t max = PROFILE_Current()->ports[port].baud_max;
+    return baud > max ? max : baud;
+}
+
+HAL_StatusTypeDef PROFILE_SetBaud(PROFILE_Port port, uint32_t baud) {
+    baud = PROFILE_ClampBaud(port, baud);
+    if (baud == 0) {
+        return HAL_ERROR;
+    }
+    if (*profile_uarts[port].baud != baud) {
+        *profile_uarts[port].baud = baud;
+        profile_uarts[port].set(baud);
+    }
+    return HAL_OK;
+}
+
+void PROFILE_Print(char* buffer) {
+    const PROFILE_Config* profile = PROFILE_Current();
+
+    strcat(buffer, profile->name);
+    for (int i = 0; i < PROFILE_PORT_COUNT; i++) {
+        const PROFILE_PortMap* port = &profile->ports[i];
+        if (port->connector == NULL) {
+            sprintf(tStr, " %s=-", profile_uarts[i].name);
+        } else {
+            sprintf(tStr, " %s=%s/%lu%s", profile_uarts[i].name, port->connector,
+                    (unsigned long)port->baud_max, port->ttl_only ? "/TTL" : "");
+        }
+        strcat(buffer, tStr);
+    }
+    sprintf(tStr, " SERCFG=%u", profile->serial_cfg);
+    strcat(buffer, tStr);
+}
+
+void PROFILE_PrintList(char* buffer) {
+    for (int i = 0; i < PROFILE_COUNT; i++) {
+        if (i) strcat(buffer, " ");
+        strcat(buffer, profile_table[i].name);
+    }
+}
@@ -0,0 +1,258 @@
+/*
+ * sequence.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: mavorpdx
+ *
+ * Timed GPIO sequencer. A list of (delay, pin, level) steps is played
+ * back from the TIM2 channel 2 compare interrupt against the micros()
+ * timebase, so step timing does not depend on the host or the main loop.
+ *
+ * MCU pins are written with BSRR inside the interrupt (a few us after
+ * the compare match). PCA9534 pins due in the same pass are merged into
+ * one interrupt-driven output write; the expander latches it one I2C
+ * transaction later (~0.3 ms at 100 kHz), so those steps are stamped
+ * from the write's completion callback rather than when it is queued.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "main.h"
+#include "sequence.h"
+#include "pca9534.h"
+#include "trigger.h"
+#include "i2c.h"
+
+#define SEQ_START_LEAD_US   50      // Arm time before the first step
+
+static SEQ_Step seq_steps[SEQ_MAX_STEPS];
+static int seq_count = 0;
+static volatile int seq_next = 0;           // Next step to execute
+static volatile bool seq_running = false;
+static uint32_t seq_start_us;               // micros() at sequence time 0
+static uint32_t seq_target_us;              // micros() when seq_next is due
+
+void SEQ_Clear(void) {
+    if (seq_running) return;
+    seq_count = 0;
+}
+
+HAL_StatusTypeDef SEQ_AddSteps(char* list, char** bad_token) {
+    char* token = strtok(list, " ,");
+    int count = seq_count;      // Steps are only committed once the whole list parsed
+    uint32_t total_us = 0;
+
+    for (int i = 0; i < count; i++) {
+        total_us += seq_steps[i].delay_us;
+    }
+
+    while (token != NULL) {
+        char* colon = strchr(token, ':');
+        char* eq = strchr(token, '=');
+        char* end;
+
+        if (seq_running || count >= SEQ_MAX_STEPS || colon == NULL || eq == NULL || eq < colon) {
+            if (bad_token) *bad_token = token;
+            return HAL_ERROR;
+        }
+
+        // Only 0 and 1: a typo must not drive the pin low
+        if (strcmp(eq + 1, "0") != 0 && strcmp(eq + 1, "1") != 0) {
+            if (bad_token) *bad_token = token;
+            return HAL_ERROR;
+        }
+
+        // Bounded so the step compare stays within half the micros() range
+        // and the run timeout in SEQ_Run cannot wrap
+        uint32_t delay_us = strtoul(token, &end, 10);
+        if (end != colon || delay_us > SEQ_MAX_TOTAL_US - total_us) {
+            if (bad_token) *bad_token = token;
+            return HAL_ERROR;
+        }
+        total_us += delay_us;
+
+        *eq = '\0';
+        SEQ_Step* step = &seq_steps[count];
+        step->delay_us = delay_us;
+        step->pin = GPIO_FindByName(colon + 1);
+        step->level = (eq[1] == '1') ? GPIO_PIN_SET : GPIO_PIN_RESET;
+        step->actual_us = 0;
+        step->done = false;
+        step->failed = false;
+        if (step->pin == NULL) {
+            if (bad_token) *bad_token = colon + 1;
+            return HAL_ERROR;
+        }
+
+        count++;
+        token = strtok(NULL, " ,");
+    }
+    seq_count = count;
+    return HAL_OK;
+}
+
+/**
+ * @brief Run every step that is due, then arm the compare for the next one
+ *
+ * Called from the TIM2 interrupt. If the next target has already passed
+ * by the time CCR2 is written, the compare would not fire until the
+ * counter wraps, so the loop runs it straight away instead.
+ */
+static void SEQ_Service(void) {
+    do {
+        uint8_t pca_output = hPCA.OutputRequest;
+        uint8_t pca_write = hPCA.TxRequests + 1;    // Serial the write below will get
+        bool pca_dirty = false;
+
+        while (seq_next < seq_count && (int32_t)(micros() - seq_target_us) >= 0) {
+            SEQ_Step* step = &seq_steps[seq_next];
+            const GPIO_PinConfig* pin = step->pin;
+
+            if (pin->type == GPIO_TYPE_MCU) {
+                pin->GPIOx->BSRR = (step->level == GPIO_PIN_SET) ?
+                                   pin->GPIO_Pin : ((uint32_t)pin->GPIO_Pin << 16);
+                step->actual_us = micros() - seq_start_us;
+                step->done = true;
+            } else {
+                if (step->level == GPIO_PIN_SET) {
+                    pca_output |= pin->PCA9534_Pin;
+                } else {
+                    pca_output &= ~pin->PCA9534_Pin;
+                }
+                // Stamped by PCA9534_OutputDoneCallback
+                step->pca_write = pca_write;
+                pca_dirty = true;
+            }
+            TRIG_Fire(TRIG_EVT_SEQ);
+
+            seq_next++;
+            if (seq_next < seq_count) {
+                seq_target_us += seq_steps[seq_next].delay_us;
+            }
+        }
+
+        if (pca_dirty) {
+            PCA9534_WriteOutput_IT(&hPCA, pca_output);
+        }
+
+        if (seq_next >= seq_count) {
+            TIM2->DIER &= ~TIM_DIER_CC2IE;
+            seq_running = false;
+            return;
+        }
+
+        TIM2->CCR2 = seq_target_us;
+    } while ((int32_t)(micros() - seq_target_us) >= 0);
+}
+
+/**
+ * @brief Stamp the PCA9534 steps settled by a finished output write
+ *
+ * Called from the I2C2 interrupt. Every queued PCA step whose request
+ * serial is not newer than the write's is done when it was acknowledged,
+ * or failed when it was not.
+ */
+void PCA9534_OutputDoneCallback(PCA9534_HandleTypeDef *hpca9534, uint8_t serial, bool ok) {
+    uint32_t now_us = micros() - seq_start_us;
+
+    if (hpca9534 != &hPCA) return;
+    for (int i = 0; i < seq_next; i++) {
+        SEQ_Step* step = &seq_steps[i];
+        if (step->pin->type == GPIO_TYPE_MCU || step->done || step->failed ||
+            (int8_t)(step->pca_write - serial) > 0) {
+            continue;
+        }
+        step->actual_us = now_us;
+        step->done = ok;
+        step->failed = !ok;
+    }
+}
+
+void TIM2_IRQHandler(void) {
+    if (TIM2->SR & TIM_SR_CC2IF) {
+        TIM2->SR = ~TIM_SR_CC2IF;
+        if (seq_running) {
+            SEQ_Service();
+        }
+    }
+    // CC3 releases an I2C slave clock stretch
+    if ((TIM2->DIER & TIM_DIER_CC3IE) && (TIM2->SR & TIM_SR_CC3IF)) {
+        TIM2->SR = ~TIM_SR_CC3IF;
+        I2C_SlaveStretchEnd();
+    }
+}
+
+HAL_StatusTypeDef SEQ_Run(void) {
+    uint32_t total_us = 0;
+
+    if (seq_count == 0 || seq_running) {
+        return HAL_ERROR;
+    }
+
+    for (int i = 0; i < seq_count; i++) {
+        seq_steps[i].done = false;
+        seq_steps[i].failed = false;
+        seq_steps[i].actual_us = 0;
+        total_us += seq_steps[i].delay_us;
+    }
+
+    seq_next = 0;
+    seq_start_us = micros() + SEQ_START_LEAD_US;
+    seq_target_us = seq_start_us + seq_steps[0].delay_us;
+    seq_running = true;
+
+    TIM2->CCR2 = seq_target_us;
+    TIM2->SR = ~TIM_SR_CC2IF;
+    HAL_NVIC_SetPriority(TIM2_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(TIM2_IRQn);
+    // DIER also holds the I2C stretch release (CC3IE), set from the I2C1 interrupt
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    TIM2->DIER |= TIM_DIER_CC2IE;
+    __set_PRIMASK(primask);
+
+    uint32_t timeout_ms = total_us / 1000 + SEQ_RUN_MARGIN_MS;
+    uint32_t start = millis();
+    while (seq_running) {
+        if (millis() - start > timeout_ms) {
+            __disable_irq();
+            TIM2->DIER &= ~TIM_DIER_CC2IE;
+            seq_running = false;
+            __set_PRIMASK(primask);
+            if(DEBUG_GPIO) printf("Error: sequence timed out at step %d\n", seq_next);
+            return HAL_ERROR;
+        }
+    }
+    // The last PCA steps are stamped when their write completes
+    while (hPCA.TxBusy) {
+        if (millis() - start > timeout_ms) {
+            if(DEBUG_GPIO) printf("Error: sequence PCA9534 write did not complete\n");
+            return HAL_ERROR;
+        }
+    }
+    return HAL_OK;
+}
+
+void SEQ_Print(char* buffer) {
+    uint32_t planned_us = 0;
+
+    sprintf(tStr, "%-3s | %-10s | %-15s | %-3s | %s\n", "#", "PLAN_US", "PIN", "LVL", "ACTUAL_US");
+    strcat(buffer, tStr);
+    strcat(buffer, "--------------------------------------------------\n");
+
+    for (int i = 0; i < seq_count; i++) {
+        planned_us += seq_steps[i].delay_us;
+        if (seq_steps[i].done) {
+            sprintf(tStr, "%-3d | %-10lu | %-15s | %-3d | %lu\n", i, (unsigned long)planned_us,
+                    seq_steps[i].pin->name, seq_steps[i].level, (unsigned long)seq_steps[i].actual_us);
+        } else if (seq_steps[i].failed) {
+            sprintf(tStr, "%-3d | %-10lu | %-15s | %-3d | FAIL %lu\n", i, (unsigned long)planned_us,
+                    seq_steps[i].pin->name, seq_steps[i].level, (unsigned long)seq_steps[i].actual_us);
+        } else {
+            sprintf(tStr, "%-3d | %-10lu | %-15s | %-3d | -\n", i, (unsigned long)planned_us,
+                    seq_steps[i].pin->name, seq_steps[i].level);
+        }
+        strcat(buffer, tStr);
+    }
+}
@@ -0,0 +1,240 @@
+/*
+ * settings.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: mavorpdx
+ *
+ * Persistent configuration (SAVE/LOAD/ERASE) in the last two flash pages.
+ *
+ * Each SAVE appends a fixed-size record (header, SETTINGS_Data, CRC-32) to
+ * the first blank slot after the newest one, so writes walk through every
+ * slot of both pages before any page is erased again. When the page is
+ * full the other page is erased and the record goes to its first slot; the
+ * old page keeps the previous record until then, so a reset during SAVE
+ * falls back to the last good record. The newest record is the valid one
+ * with the highest sequence number; a torn write fails its CRC and is
+ * skipped.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stddef.h>
+
+#include "main.h"
+#include "settings.h"
+#include "uart.h"
+#include "i2c.h"
+#include "profile.h"
+
+typedef struct {
+    uint32_t magic;             // SETTINGS_MAGIC
+    uint16_t version;           // SETTINGS_VERSION
+    uint16_t length;            // sizeof(SETTINGS_Data)
+    uint32_t sequence;          // +1 per save, the highest valid record wins
+    SETTINGS_Data data;
+    uint32_t crc;               // CRC-32 of everything above
+} SETTINGS_Record;
+
+#define SETTINGS_SLOTS  ((int)(SETTINGS_PAGE_SIZE / sizeof(SETTINGS_Record)))
+
+_Static_assert(sizeof(SETTINGS_Record) % 4 == 0, "records are programmed a word at a time");
+
+static uint32_t SETTINGS_SlotAddress(int page, int slot) {
+    return SETTINGS_FLASH_ADDR + page * SETTINGS_PAGE_SIZE + slot * sizeof(SETTINGS_Record);
+}
+
+static const SETTINGS_Record* SETTINGS_Slot(int page, int slot) {
+    return (const SETTINGS_Record*)(uintptr_t)SETTINGS_SlotAddress(page, slot);
+}
+
+/* CRC-32 (IEEE, reflected), bitwise: a record is only ~60 bytes */
+static uint32_t SETTINGS_Crc(const void* data, size_t length) {
+    const uint8_t* p = data;
+    uint32_t crc = 0xFFFFFFFF;
+
+    while (length--) {
+        crc ^= *p++;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320U & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static bool SETTINGS_SlotBlank(const SETTINGS_Record* record) {
+    const uint32_t* word = (const uint32_t*)record;
+
+    for (size_t i = 0; i < sizeof(*record) / 4; i++) {
+        if (word[i] != 0xFFFFFFFF) return false;
+    }
+    return true;
+}
+
+static bool SETTINGS_SlotValid(const SETTINGS_Record* record) {
+    return record->magic == SETTINGS_MAGIC && record->version == SETTINGS_VERSION &&
+           record->length == sizeof(SETTINGS_Data) &&
+           record->crc == SETTINGS_Crc(record, offsetof(SETTINGS_Record, crc));
+}
+
+/* Newest valid record, NULL if there is none */
+static const SETTINGS_Record* SETTINGS_FindLatest(int* page, int* slot) {
+    const SETTINGS_Record* latest = NULL;
+
+    for (int p = 0; p < SETTINGS_PAGES; p++) {
+        for (int s = 0; s < SETTINGS_SLOTS; s++) {
+            const SETTINGS_Record* record = SETTINGS_Slot(p, s);
+            if (SETTINGS_SlotValid(record) &&
+                (latest == NULL || (int32_t)(record->sequence - latest->sequence) > 0)) {
+                latest = record;
+                *page = p;
+                *slot = s;
+            }
+        }
+    }
+    return latest;
+}
+
+static HAL_StatusTypeDef SETTINGS_ErasePage(int page) {
+    FLASH_EraseInitTypeDef erase = {0};
+    uint32_t page_error;
+
+    erase.TypeErase = FLASH_TYPEERASE_PAGES;
+    erase.PageAddress = SETTINGS_FLASH_ADDR + page * SETTINGS_PAGE_SIZE;
+    erase.NbPages = 1;
+    return HAL_FLASHEx_Erase(&erase, &page_error);
+}
+
+/* Current configuration, as SAVE stores it */
+static void SETTINGS_Capture(SETTINGS_Data* data) {
+    memset(data, 0, sizeof(*data));
+    data->baud0 = comBaud0;
+    data->baud1 = comBaud1;
+    data->baud2 = comBaud2;
+    data->baud3 = comBaud3;
+    data->baud485 = comBaud485;
+    data->serial_cfg = serialCFG;
+    data->i2c_address = I2C_GetSlaveAddress();
+    data->profile = controllerType;
+    data->pin_count = (uint8_t)GPIO_GetOutputStates(data->outputs, data->levels);
+}
+
+HAL_StatusTypeDef SETTINGS_Save(uint32_t* sequence) {
+    SETTINGS_Record record;
+    int page = 0;
+    int slot = -1;
+    const SETTINGS_Record* latest = SETTINGS_FindLatest(&page, &slot);
+    const SETTINGS_Record* target;
+    HAL_StatusTypeDef status = HAL_OK;
+
+    memset(&record, 0, sizeof(record));
+    record.magic = SETTINGS_MAGIC;
+    record.version = SETTINGS_VERSION;
+    record.length = sizeof(SETTINGS_Data);
+    record.sequence = latest ? latest->sequence + 1 : 1;
+    SETTINGS_Capture(&record.data);
+    record.crc = SETTINGS_Crc(&record, offsetof(SETTINGS_Record, crc));
+
+    // First blank slot after the newest record; torn slots in between are skipped
+    do {
+        slot++;
+    } while (slot < SETTINGS_SLOTS && !SETTINGS_SlotBlank(SETTINGS_Slot(page, slot)));
+
+    HAL_FLASH_Unlock();
+    if (slot >= SETTINGS_SLOTS || latest == NULL) {
+        // Page full (or nothing valid anywhere): start over on a freshly erased page
+        if (latest) page = (page + 1) % SETTINGS_PAGES;
+        slot = 0;
+        if (!SETTINGS_SlotBlank(SETTINGS_Slot(page, 0)) || latest) {
+            status = SETTINGS_ErasePage(page);
+        }
+    }
+
+    target = SETTINGS_Slot(page, slot);
+    const uint32_t* word = (const uint32_t*)&record;
+    for (size_t i = 0; i < sizeof(record) / 4 && status == HAL_OK; i++) {
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, SETTINGS_SlotAddress(page, slot) + i * 4, word[i]);
+    }
+    HAL_FLASH_Lock();
+
+    if (status != HAL_OK || memcmp(target, &record, sizeof(record)) != 0) {
+        if(DEBUG_UART) printf("Error: settings write failed at page %d slot %d\n", page, slot);
+        return HAL_ERROR;
+    }
+    if (sequence) *sequence = record.sequence;
+    return HAL_OK;
+}
+
+/*
+ * Apply a saved port rate. A rate above the current profile's limit is
+ * left out rather than clamped, so LOAD reports it. Only ports whose rate
+ * changes are re-initialised; COM3 is the USB bridge and is only recorded.
+ */
+static bool SETTINGS_LoadBaud(PROFILE_Port port, uint32_t baud) {
+    if (baud == 0) {
+        return true;    // Not saved
+    }
+    if (PROFILE_ClampBaud(port, baud) != baud) {
+        if(DEBUG_UART) printf("Error: saved rate %lu above the profile limit\n", (unsigned long)baud);
+        return false;
+    }
+    if (port == PROFILE_PORT_COM3) {
+        comBaud3 = baud;
+        return true;
+    }
+    return PROFILE_SetBaud(port, baud) == HAL_OK;
+}
+
+SETTINGS_LoadResult SETTINGS_Load(uint32_t* sequence) {
+    int page;
+    int slot;
+    const SETTINGS_Record* latest = SETTINGS_FindLatest(&page, &slot);
+    const SETTINGS_Data* data;
+    SETTINGS_LoadResult result = SETTINGS_LOAD_OK;
+
+    if (latest == NULL) {
+        return SETTINGS_LOAD_NONE;
+    }
+    data = &latest->data;
+    if (sequence) *sequence = latest->sequence;
+
+    // The profile sets the ADC windows and baud limits; its defaults are overridden below anyway
+    if (data->profile != controllerType && PROFILE_Select(data->profile, false) != HAL_OK) {
+        result = SETTINGS_LOAD_PARTIAL;
+    }
+
+    if (!SETTINGS_LoadBaud(PROFILE_PORT_COM0, data->baud0) ||
+        !SETTINGS_LoadBaud(PROFILE_PORT_COM1, data->baud1) ||
+        !SETTINGS_LoadBaud(PROFILE_PORT_COM2, data->baud2) ||
+        !SETTINGS_LoadBaud(PROFILE_PORT_COM485, data->baud485) ||
+        !SETTINGS_LoadBaud(PROFILE_PORT_COM3, data->baud3)) {
+        result = SETTINGS_LOAD_PARTIAL;
+    }
+
+    // Outputs first: the transceiver pins are then set by the serial mode
+    if (GPIO_SetOutputStates(data->pin_count, data->outputs, data->levels) != HAL_OK) {
+        if(DEBUG_GPIO) printf("Error: saved output states not applied\n");
+        result = SETTINGS_LOAD_PARTIAL;
+    }
+    if (data->serial_cfg < GPIO_SerialModeCount()) {
+        serialCFG = data->serial_cfg;
+        setSerialCFG();
+    } else {
+        result = SETTINGS_LOAD_PARTIAL;
+    }
+
+    if (data->i2c_address != I2C_GetSlaveAddress() &&
+        I2C_SetSlaveAddress(data->i2c_address) != HAL_OK) {
+        result = SETTINGS_LOAD_PARTIAL;
+    }
+    return result;
+}
+
+HAL_StatusTypeDef SETTINGS_Erase(void) {
+    HAL_StatusTypeDef status = HAL_OK;
+
+    HAL_FLASH_Unlock();
+    for (int p = 0; p < SETTINGS_PAGES && status == HAL_OK; p++) {
+        status = SETTINGS_ErasePage(p);
+    }
+    HAL_FLASH_Lock();
+    return status;
+}
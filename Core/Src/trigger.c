@@ -0,0 +1,161 @@
+/*
+ * trigger.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: mavorpdx
+ *
+ * Trigger output on P105 (PA15) for external instruments.
+ *
+ * In trigger mode PA15 is TIM2_CH1 (AF2). A pulse starts by forcing OC1REF
+ * active and ends in hardware: the channel is then switched to "inactive
+ * on match" with CCR1 = now + width, so no interrupt is needed to finish
+ * it. TIM2 is the 1 MHz micros() counter, so the width is -1/+0 us. An
+ * event during a pulse stretches it to end width_us after the new event.
+ *
+ * Latency from the TRIG_Fire() call to the edge is the forced-mode write,
+ * under 1 us with interrupts masked around it. Where the call sits sets
+ * what the edge marks:
+ *  - CMD:   start of command execution in the main loop. This trails the
+ *           command's last byte by up to one main loop pass (~10 ms).
+ *  - ADC:   just before the first ADSTART of a scan, < 1 us.
+ *  - SEQ:   in the TIM2 interrupt right after each step is written, < 1 us
+ *           after an MCU pin edge; a PCA9534 pin latches ~0.3 ms later.
+ *  - MATCH: in the UART receive interrupt for the byte that completes the
+ *           pattern, a few us after its stop bit plus any other priority 0
+ *           interrupt being serviced at the time.
+ */
+#include <string.h>
+#include <stdio.h>
+
+#include "main.h"
+#include "trigger.h"
+#include "command.h"
+
+#define TRIG_OC1M_FORCE_INACTIVE    (TIM_CCMR1_OC1M_2)
+#define TRIG_OC1M_FORCE_ACTIVE      (TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_0)
+#define TRIG_OC1M_INACTIVE_ON_MATCH (TIM_CCMR1_OC1M_1)
+
+static const char* const trig_names[TRIG_EVT_COUNT] = { "CMD", "ADC", "SEQ", "MATCH", "MANUAL" };
+
+static bool trig_enabled = false;           // P105 is on TIM2_CH1
+static volatile uint32_t trig_mask = 0;
+static uint32_t trig_width_us = TRIG_DEFAULT_WIDTH_US;
+static bool trig_active_low = false;
+static volatile uint32_t trig_counts[TRIG_EVT_COUNT];
+static volatile uint32_t trig_last_us;
+static volatile TRIG_Event trig_last_event;
+
+static void TRIG_SetPinMode(bool timer) {
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    GPIO_InitStruct.Pin = P105_PIN;
+    GPIO_InitStruct.Mode = timer ? GPIO_MODE_AF_PP : GPIO_MODE_OUTPUT_PP;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+    GPIO_InitStruct.Alternate = GPIO_AF2_TIM2;
+    HAL_GPIO_Init(P105_GPIO_Port, &GPIO_InitStruct);
+}
+
+HAL_StatusTypeDef TRIG_Configure(uint32_t mask, uint32_t width_us, bool active_low) {
+    if (width_us < TRIG_MIN_WIDTH_US || width_us > TRIG_MAX_WIDTH_US) {
+        return HAL_ERROR;
+    }
+
+    trig_mask = 0;
+    trig_width_us = width_us;
+    trig_active_low = active_low;
+
+    // CH2 belongs to the sequencer, only touch the CH1 fields
+    TIM2->CCMR1 = (TIM2->CCMR1 & ~(TIM_CCMR1_CC1S | TIM_CCMR1_OC1M | TIM_CCMR1_OC1PE)) |
+                  TRIG_OC1M_FORCE_INACTIVE;
+    TIM2->CCER = (TIM2->CCER & ~TIM_CCER_CC1P) | TIM_CCER_CC1E | (active_low ? TIM_CCER_CC1P : 0);
+
+    if (!trig_enabled) {
+        TRIG_SetPinMode(true);
+        trig_enabled = true;
+    }
+    memset((void*)trig_counts, 0, sizeof(trig_counts));
+    trig_mask = mask;
+    return HAL_OK;
+}
+
+void TRIG_Release(void) {
+    trig_mask = 0;
+    if (!trig_enabled) {
+        return;
+    }
+    HAL_GPIO_WritePin(P105_GPIO_Port, P105_PIN, GPIO_PIN_RESET);
+    TRIG_SetPinMode(false);
+    TIM2->CCER &= ~(TIM_CCER_CC1E | TIM_CCER_CC1P);
+    TIM2->CCMR1 &= ~TIM_CCMR1_OC1M;
+    trig_enabled = false;
+}
+
+void TRIG_Fire(TRIG_Event event) {
+    if (!trig_enabled || (event != TRIG_EVT_MANUAL && !(trig_mask & (1U << event)))) {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    TIM2->CCMR1 = (TIM2->CCMR1 & ~TIM_CCMR1_OC1M) | TRIG_OC1M_FORCE_ACTIVE;
+    uint32_t now = micros();
+    TIM2->CCR1 = now + trig_width_us;
+    TIM2->CCMR1 = (TIM2->CCMR1 & ~TIM_CCMR1_OC1M) | TRIG_OC1M_INACTIVE_ON_MATCH;
+    trig_last_us = now;
+    trig_last_event = event;
+    trig_counts[event]++;
+    __set_PRIMASK(primask);
+}
+
+HAL_StatusTypeDef TRIG_ParseEvents(char* list, uint32_t* mask) {
+    char* token = strtok(list, ",");
+
+    *mask = 0;
+    while (token != NULL) {
+        int i;
+        if (strcmp(token, "ALL") == 0) {
+            *mask |= (1U << TRIG_EVT_MANUAL) - 1;
+        } else if (strcmp(token, "NONE") != 0) {
+            for (i = 0; i < TRIG_EVT_MANUAL; i++) {
+                if (strcmp(token, trig_names[i]) == 0) break;
+            }
+            if (i == TRIG_EVT_MANUAL) {
+                return HAL_ERROR;
+            }
+            *mask |= 1U << i;
+        }
+        token = strtok(NULL, ",");
+    }
+    return HAL_OK;
+}
+
+void TRIG_PrintStatus(char* buffer) {
+    bool first = true;
+
+    if (!trig_enabled) {
+        strcat(buffer, "OFF");
+        return;
+    }
+
+    strcat(buffer, "events=");
+    for (int i = 0; i < TRIG_EVT_MANUAL; i++) {
+        if (trig_mask & (1U << i)) {
+            if (!first) strcat(buffer, ",");
+            strcat(buffer, trig_names[i]);
+            first = false;
+        }
+    }
+    if (first) strcat(buffer, "NONE");
+
+    sprintf(tStr, " width_us=%lu %s", (unsigned long)trig_width_us, trig_active_low ? "LOW" : "HIGH");
+    strcat(buffer, tStr);
+    for (int i = 0; i < TRIG_EVT_COUNT; i++) {
+        sprintf(tStr, " %s=%lu", trig_names[i], (unsigned long)trig_counts[i]);
+        strcat(buffer, tStr);
+    }
+    if (trig_counts[trig_last_event]) {
+        sprintf(tStr, " last=%s@%lu", trig_names[trig_last_event], (unsigned long)trig_last_us);
+        strcat(buffer, tStr);
+    }
+}
@@ -15,23 +15,9 @@
 #include "uart.h"
 #include "command.h"
 #include "adc.h"
+#include "trigger.h"
 
-//SLCD5
-//COM0 USART1  J6 8pin
-//COM1 USART3  J7 10pin
-//485  USART4  J7 10pin
-
-//SLCD43
-//COM0 USART1  J2  8pin up to 230,400 baud
-//COM1 USART3  J1 10pin TTL ONLY
-//COM2 USART5  J4 10pin
-//COM3 USARTx  J3  5pin up to 460,800 baud
-
-//SLCD6
-//COM0 USART1  J6   8pin up to 230,400 baud
-//COM1 USART3  JP1 10pin TTL Only
-//COM2 USART5  J9   5pin
-//COM3 USARTx  CN1  5pin up to 460,800 baud
+// COM port to USART and DUT connector mapping per model: profile_table[] in profile.c
 
 uint32_t comBaud0 = SERIAL_BAUD;
 uint32_t comBaud1 = SERIAL_BAUD;
@@ -47,7 +33,7 @@ UART_HandleTypeDef huart4;  // UART4 (RS485)
 UART_HandleTypeDef huart5;  // UART5
 
 char serialBuffer[UART_BUFFER_SIZE];
-static uint8_t bufferIndex = 0;
+static uint16_t bufferIndex = 0;
 
 // ******************************************************************
 /* Buffer for received commands */
@@ -69,6 +55,21 @@ UARTBuffer uart5Buffer = {0};
 
 uint8_t serialCFG = 0;  //start as 232
 
+// ******************************************************************
+// Receive watch for BOOTTIME: first byte and banner match timestamps
+// ******************************************************************
+static struct {
+    USART_TypeDef* volatile instance;       // Port being watched, NULL when idle
+    char pattern[UART_WATCH_MAX_PATTERN + 1];
+    uint8_t fail[UART_WATCH_MAX_PATTERN];    // KMP fallback: longest prefix that is also a suffix
+    uint8_t length;
+    uint8_t matched;                         // Pattern characters matched so far
+    volatile bool first_seen;
+    volatile uint32_t first_us;
+    volatile bool match_seen;
+    volatile uint32_t match_us;
+} uart_watch;
+
 
 // Function to change the baud rate of a specific UART
 void ChangeBaudRate(UART_HandleTypeDef *huart, uint32_t baudRate) {
@@ -125,8 +126,37 @@ void addToBuffer(UARTBuffer* buffer, uint8_t data) {
 // UART interrupt callbacks
 // ******************************************************************
 
+/* Called for every received byte with micros() taken on entry to the callback */
+static void UART_WatchByte(USART_TypeDef* instance, uint8_t byte, uint32_t now)
+{
+    if (uart_watch.instance != instance) {
+        return;
+    }
+    if (!uart_watch.first_seen) {
+        uart_watch.first_us = now;
+        uart_watch.first_seen = true;
+    }
+    if (uart_watch.match_seen || uart_watch.length == 0) {
+        return;
+    }
+
+    while (uart_watch.matched > 0 && byte != (uint8_t)uart_watch.pattern[uart_watch.matched]) {
+        uart_watch.matched = uart_watch.fail[uart_watch.matched - 1];
+    }
+    if (byte == (uint8_t)uart_watch.pattern[uart_watch.matched]) {
+        uart_watch.matched++;
+    }
+    if (uart_watch.matched == uart_watch.length) {
+        uart_watch.match_us = now;
+        uart_watch.match_seen = true;
+        TRIG_Fire(TRIG_EVT_MATCH);
+    }
+}
+
 void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 {
+    uint32_t now = micros();
+
     if (huart->Instance == USART2) {
         //if(DEBUG_UART) printf("DBG: UART2 IRQ got byte: 0x%02X\n", rxByte2);  // Add this
         addToBuffer(&uart2Buffer, rxByte2);
@@ -134,21 +164,25 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
     }
     else if (huart->Instance == USART1) {
 //        if(DEBUG_UART) printf("DBG: UART1 IRQ got byte: 0x%02X\n", rxByte1);  // Add this
+        UART_WatchByte(huart->Instance, rxByte1, now);
         addToBuffer(&uart1Buffer, rxByte1);
         HAL_UART_Receive_IT(&huart1, (uint8_t*)&rxByte1, 1);
     }
     else if (huart->Instance == USART3) {
 //        if(DEBUG_UART) printf("DBG: UART3 IRQ got byte: 0x%02X\n", rxByte3);  // Add this
+        UART_WatchByte(huart->Instance, rxByte3, now);
         addToBuffer(&uart3Buffer, rxByte3);
         HAL_UART_Receive_IT(&huart3, (uint8_t*)&rxByte3, 1);
     }
     else if (huart->Instance == USART4) {
 //        if(DEBUG_UART) printf("DBG:4 IRQ got byte: 0x%02X\n", rxByte4);  // Add this
+        UART_WatchByte(huart->Instance, rxByte4, now);
         addToBuffer(&uart4Buffer, rxByte4);
         HAL_UART_Receive_IT(&huart4, (uint8_t*)&rxByte4, 1);
     }
     else if (huart->Instance == USART5) {
 //        if(DEBUG_UART) printf("DBG: UART5 IRQ got byte: 0x%02X\n", rxByte5);  // Add this
+        UART_WatchByte(huart->Instance, rxByte5, now);
         addToBuffer(&uart5Buffer, rxByte5);
         HAL_UART_Receive_IT(&huart5, (uint8_t*)&rxByte5, 1);
     }
@@ -256,7 +290,7 @@ void handleCommandPort(void) {
         if (byte == '\r' || byte == '\n') {
             cmdBuffer[bufferIndex] = '\0'; // Null-terminate command string
 
-            if (bufferIndex > 0) {
+            if (bufferIndex > 0 && bufferIndex < LAST_CMD_BUFFER_SIZE) {
                 strcpy(lastCommand, cmdBuffer);  // Store the command
             }
 
@@ -416,6 +450,183 @@ void handleSerialCommunications(void) {
 }
 
 
+// ******************************************************************
+// DUT boot time
+// ******************************************************************
+UART_HandleTypeDef* UART_FindPort(const char* name) {
+    if (strcasecmp(name, "COM0") == 0) return &huart1;
+    if (strcasecmp(name, "COM1") == 0) return &huart3;
+    if (strcasecmp(name, "COM485") == 0) return &huart4;
+    if (strcasecmp(name, "COM2") == 0) return &huart5;
+    return NULL;
+}
+
+/**
+ * @brief Arm the receive watch on a port
+ * @param huart: Port to watch
+ * @param pattern: Banner to match, or "" to stop at the first byte
+ * @return HAL_OK, or HAL_ERROR if the pattern is too long
+ *
+ * Only one port is watched at a time; arming again replaces the previous watch.
+ */
+HAL_StatusTypeDef UART_WatchStart(UART_HandleTypeDef* huart, const char* pattern) {
+    size_t length = strlen(pattern);
+    if (huart == NULL || length > UART_WATCH_MAX_PATTERN) {
+        return HAL_ERROR;
+    }
+
+    uart_watch.instance = NULL;
+
+    uart_watch.length = (uint8_t)length;
+    memcpy(uart_watch.pattern, pattern, length + 1);
+    uart_watch.fail[0] = 0;
+    for (uint8_t i = 1, k = 0; i < uart_watch.length; i++) {
+        while (k > 0 && pattern[i] != pattern[k]) {
+            k = uart_watch.fail[k - 1];
+        }
+        if (pattern[i] == pattern[k]) {
+            k++;
+        }
+        uart_watch.fail[i] = k;
+    }
+    uart_watch.matched = 0;
+    uart_watch.first_seen = false;
+    uart_watch.match_seen = false;
+
+    uart_watch.instance = huart->Instance;
+    return HAL_OK;
+}
+
+void UART_WatchStop(void) {
+    uart_watch.instance = NULL;
+}
+
+/* A watch is armed (CYCLE banner or BOOTTIME) */
+bool UART_WatchActive(void) {
+    return uart_watch.instance != NULL;
+}
+
+/* micros() of the first byte since UART_WatchStart, false if none yet */
+bool UART_WatchFirst(uint32_t* when_us) {
+    if (!uart_watch.first_seen) {
+        return false;
+    }
+    *when_us = uart_watch.first_us;
+    return true;
+}
+
+/* micros() of the pattern match (or first byte for an empty pattern), false if not yet */
+bool UART_WatchDone(uint32_t* when_us) {
+    if (uart_watch.length == 0) {
+        return UART_WatchFirst(when_us);
+    }
+    if (!uart_watch.match_seen) {
+        return false;
+    }
+    *when_us = uart_watch.match_us;
+    return true;
+}
+
+// BOOTTIME in progress, finished by UART_BootProcess()
+static struct {
+    bool running;
+    uint32_t released_us;               // micros() at the reset release
+    uint32_t start_ms;                  // millis() at the reset release
+    uint32_t timeout_ms;
+    uint32_t width_us;                  // Measured reset pulse width
+} uart_boot;
+
+/**
+ * @brief Pulse a DUT reset line and start timing its boot on a UART
+ * @param reset: MCU output driving the reset, asserted at its activeState
+ * @param width_us: How long to hold reset, up to BOOT_RESET_WIDTH_MAX_US
+ * @param huart: DUT port (see UART_FindPort)
+ * @param pattern: Banner to wait for, or "" for the first byte
+ * @param timeout_ms: Give up this long after the release
+ * @return HAL_OK, HAL_BUSY if the receive watch is in use, or HAL_ERROR on a bad argument
+ *
+ * Only the reset pulse is timed here; UART_BootProcess() replies once the
+ * banner is seen or the timeout passes. Bytes are timestamped in the
+ * receive interrupt, i.e. at the end of their stop bit, so the times
+ * include one character time on the wire.
+ */
+HAL_StatusTypeDef UART_BootStart(const GPIO_PinConfig* reset, uint32_t width_us,
+                                 UART_HandleTypeDef* huart, const char* pattern,
+                                 uint32_t timeout_ms) {
+    if (reset == NULL || huart == NULL || pattern == NULL ||
+        reset->type != GPIO_TYPE_MCU || reset->dir != GPIO_DIR_OUTPUT ||
+        strlen(pattern) > UART_WATCH_MAX_PATTERN || width_us > BOOT_RESET_WIDTH_MAX_US) {
+        return HAL_ERROR;
+    }
+    if (UART_WatchActive()) {
+        return HAL_BUSY;
+    }
+
+    uint32_t assert_bits = (reset->activeState == GPIO_PIN_SET) ? reset->GPIO_Pin : ((uint32_t)reset->GPIO_Pin << 16);
+    uint32_t release_bits = (reset->activeState == GPIO_PIN_SET) ? ((uint32_t)reset->GPIO_Pin << 16) : reset->GPIO_Pin;
+
+    reset->GPIOx->BSRR = assert_bits;
+    uint32_t asserted = micros();
+    while (micros() - asserted < width_us) {
+    }
+
+    // Armed just before the release so output from the held DUT is ignored
+    UART_WatchStart(huart, pattern);
+    reset->GPIOx->BSRR = release_bits;
+    uart_boot.released_us = micros();
+    uart_boot.start_ms = millis();
+    uart_boot.width_us = uart_boot.released_us - asserted;
+    uart_boot.timeout_ms = timeout_ms;
+    uart_boot.running = true;
+    return HAL_OK;
+}
+
+/**
+ * @brief Reply to a running BOOTTIME once the banner is seen or it times out, called from the main loop
+ *
+ * Replies "<boot_us> first=<us|-> width=<us>", with TIMEOUT for boot_us if
+ * the banner was not seen; times are relative to the reset release.
+ */
+void UART_BootProcess(void) {
+    UART_BootResult result = {0};
+    HAL_StatusTypeDef status = HAL_OK;
+    char reply[64];
+    char first[12];
+    uint32_t when;
+
+    if (!uart_boot.running) {
+        return;
+    }
+    if (!UART_WatchDone(&when)) {
+        if (millis() - uart_boot.start_ms <= uart_boot.timeout_ms) {
+            return;
+        }
+        status = HAL_TIMEOUT;
+    }
+    UART_WatchStop();
+    uart_boot.running = false;
+
+    result.width_us = uart_boot.width_us;
+    if (UART_WatchFirst(&when)) {
+        result.first_seen = true;
+        result.first_us = when - uart_boot.released_us;
+    }
+    if (status == HAL_OK && UART_WatchDone(&when)) {
+        result.boot_us = when - uart_boot.released_us;
+        sprintf(reply, "%lu", (unsigned long)result.boot_us);
+    } else {
+        strcpy(reply, "TIMEOUT");
+    }
+    if (result.first_seen) {
+        sprintf(first, "%lu", (unsigned long)result.first_us);
+    } else {
+        strcpy(first, "-");
+    }
+    sprintf(reply + strlen(reply), " first=%s width=%lu", first, (unsigned long)result.width_us);
+    sendReply("BOOTTIME", reply);
+}
+
+
 // ******************************************************************
 // RS485 communication
 // ******************************************************************
@@ -11,6 +11,7 @@
 #include <limits.h>
 #include <ctype.h>
 
+#include "stm32f0xx_hal.h"
 #include "utils.h"
 #include <cmsis_gcc.h>
 
@@ -35,6 +36,25 @@ void Error_Handler(void)
   }
 }
 
+/**
+ * @brief Start TIM2 as a free-running 1 MHz counter for micros()
+ *
+ * TIM2 is the only 32-bit timer on the F091, so the count only wraps
+ * every 2^32 us. No interrupt is used; unsigned subtraction handles wrap.
+ */
+void Micros_Init(void)
+{
+  __HAL_RCC_TIM2_CLK_ENABLE();
+
+  TIM2->CR1 = 0;
+  TIM2->PSC = (SystemCoreClock / 1000000U) - 1;
+  TIM2->ARR = 0xFFFFFFFF;
+  TIM2->CNT = 0;
+  TIM2->EGR = TIM_EGR_UG;      // Load the prescaler now
+  TIM2->SR = 0;
+  TIM2->CR1 = TIM_CR1_CEN;
+}
+
 void str2upper(char* str) {
     if (!str) return;
     while (*str) {
@@ -70,6 +90,33 @@ uint32_t str2num(const char *data) {
     return (uint32_t)num;
 }
 
+/**
+ * @brief Convert a hex string like "0A1B2C" or "0A 1B 2C" to bytes
+ * @param hex: Pairs of hex digits, spaces between pairs are skipped
+ * @param out: Output bytes
+ * @param max_len: Size of out
+ * @return Number of bytes, or -1 on a bad digit, an odd digit count or overflow
+ */
+int hex2bytes(const char *hex, uint8_t *out, int max_len) {
+    int count = 0;
+    char pair[3] = {0};
+
+    while (*hex) {
+        if (*hex == ' ') {
+            hex++;
+            continue;
+        }
+        if (!isxdigit((unsigned char)hex[0]) || !isxdigit((unsigned char)hex[1]) || count >= max_len) {
+            return -1;
+        }
+        pair[0] = hex[0];
+        pair[1] = hex[1];
+        out[count++] = (uint8_t)strtoul(pair, NULL, 16);
+        hex += 2;
+    }
+    return count;
+}
+
 
 #ifdef  USE_FULL_ASSERT
 /**
@@ -135,7 +135,11 @@ def apply_device_config(ser, device_config):
     
     try:
         print_debug("Applying device configuration...")
-        
+
+        # Stage every key in one CONFIG block; the tester applies them at END
+        # and answers once with any per-key errors
+        send_serial_string(ser, "config begin")
+
         # Process all sections except device_info
         for section_name, section_data in device_config.items():
 
@@ -154,14 +158,15 @@ def apply_device_config(ser, device_config):
                         command = f"clr {key}"
                     #print_debug(f"Sending command '{command}'")
                     send_serial_string(ser, command)
-                    read_serial_with_packet_processing(ser, 1.0)
 
                 else:
                     # Handle other types of settings
                     command = f"{key} {value}"
                     #print_debug(f"Setting {key}: sending command '{command}'")
                     send_serial_string(ser, command)
-                    read_serial_with_packet_processing(ser, 1.0)
+
+        send_serial_string(ser, "end")
+        read_serial_with_packet_processing(ser, 1.0)
 
         print_debug("Device configuration applied successfully!")
         return True
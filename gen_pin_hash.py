@@ -0,0 +1,71 @@
+'''
+Regenerate the perfect-hash slot table for the pin names in Core/Src/gpio.c
+
+Usage
+$ python gen_pin_hash.py
+
+Reads the .name entries of gpio_pins[] in order, searches for a hash seed
+that maps every upper-cased name to its own slot, and rewrites the block
+between the BEGIN/END GENERATED PIN HASH markers. The hash must match
+GPIO_NameHash() in gpio.c (FNV-1a over upper-cased characters, top bits).
+'''
+import re
+import sys
+
+GPIO_C = 'Core/Src/gpio.c'
+HASH_BITS = 6            # 64 slots
+FNV_PRIME = 16777619
+BEGIN = '/* BEGIN GENERATED PIN HASH */'
+END = '/* END GENERATED PIN HASH */'
+
+
+def name_hash(name, seed):
+    h = seed
+    for c in name.upper():
+        h = ((h ^ ord(c)) * FNV_PRIME) & 0xFFFFFFFF
+    return h >> (32 - HASH_BITS)
+
+
+def main():
+    src = open(GPIO_C).read()
+    table = src[src.index('gpio_pins[] = {'):]
+    table = table[:table.index('\n};')]
+    names = re.findall(r'\.name\s*=\s*"([^"]+)"', table)
+
+    upper = [n.upper() for n in names]
+    if len(set(upper)) != len(upper):
+        sys.exit('Duplicate pin names in gpio_pins[]')
+    if len(names) > (1 << HASH_BITS):
+        sys.exit('Too many pins for HASH_BITS')
+
+    for seed in range(2166136261, 2166136261 + 1000000):
+        slots = [-1] * (1 << HASH_BITS)
+        for i, n in enumerate(names):
+            s = name_hash(n, seed)
+            if slots[s] != -1:
+                break
+            slots[s] = i
+        else:
+            break
+    else:
+        sys.exit('No perfect seed found, increase HASH_BITS')
+
+    out = [BEGIN,
+           '#define GPIO_NAME_HASH_BITS  %d' % HASH_BITS,
+           '#define GPIO_NAME_HASH_SEED  %uU' % seed,
+           '',
+           '// Hash slot -> gpio_pins[] index, -1 for an empty slot',
+           'static const int8_t gpio_name_slots[1 << GPIO_NAME_HASH_BITS] = {']
+    for row in range(0, len(slots), 16):
+        out.append('    ' + ', '.join('%2d' % v for v in slots[row:row + 16]) + ',')
+    out[-1] = out[-1].rstrip(',')
+    out += ['};', END]
+
+    start = src.index(BEGIN)
+    stop = src.index(END) + len(END)
+    open(GPIO_C, 'w').write(src[:start] + '\n'.join(out) + src[stop:])
+    print('%d pins, seed %u' % (len(names), seed))
+
+
+if __name__ == '__main__':
+    main()